@@ -0,0 +1,31 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+
+namespace eosio {
+    /**
+     *  Local stand-in of the `eosio.token` contract interface (balance reads only)
+     */
+    class token {
+    public:
+        struct account {
+            asset   balance;
+
+            uint64_t primary_key() const { return balance.symbol.code().raw(); }
+        };
+        typedef eosio::multi_index< "accounts"_n, account > accounts;
+
+        static asset get_balance( const name& token_contract_account, const name& owner, const symbol_code& sym_code )
+        {
+            accounts accountstable( token_contract_account, owner.value );
+            const auto& ac = accountstable.get( sym_code.raw() );
+            return ac.balance;
+        }
+    };
+
+    inline void from_json( const testing::json& value, token::account& res )
+    {
+        from_json( value["balance"], res.balance );
+    }
+}
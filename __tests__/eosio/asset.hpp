@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "name.hpp"
+#include "symbol.hpp"
+
+namespace eosio {
+    /**
+     *  Local stand-in of `eosio::asset` (amount in the smallest unit of the symbol)
+     */
+    struct asset {
+        int64_t         amount = 0;
+        eosio::symbol   symbol;
+
+        asset() = default;
+        asset( const int64_t a, const eosio::symbol s ) : amount( a ), symbol( s ) {}
+
+        std::string to_string() const
+        {
+            const uint8_t precision = symbol.precision();
+            const bool negative = amount < 0;
+            std::string digits = std::to_string( negative ? -static_cast<uint64_t>(amount) : static_cast<uint64_t>(amount) );
+            if ( precision ) {
+                if ( digits.size() <= precision ) digits.insert( 0, precision + 1 - digits.size(), '0' );
+                digits.insert( digits.size() - precision, "." );
+            }
+            return (negative ? "-" : "") + digits + " " + symbol.code().to_string();
+        }
+
+        friend bool operator==( const asset& a, const asset& b ) { return a.amount == b.amount && a.symbol == b.symbol; }
+        friend bool operator!=( const asset& a, const asset& b ) { return !(a == b); }
+    };
+
+    /**
+     *  Local stand-in of `eosio::extended_asset` (asset + token contract)
+     */
+    struct extended_asset {
+        asset   quantity;
+        name    contract;
+
+        extended_asset() = default;
+        extended_asset( const asset q, const name c ) : quantity( q ), contract( c ) {}
+    };
+}
@@ -1,4 +1,14 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
 namespace eosio {
+    namespace testing {
+        // set while a test expects a failing check (see `check_failure`)
+        inline bool& expecting_failure() { static thread_local bool res = false; return res; }
+    }
+
     /**
      *  Assert if the predicate fails and use the supplied message.
      *
@@ -10,6 +20,34 @@ namespace eosio {
      *  @endcode
      */
     inline void check( bool pred, const char* msg ) {
+#ifdef REQUIRE
+        if ( !pred && testing::expecting_failure() ) throw std::runtime_error( msg );
         REQUIRE( pred );
+#else
+        if ( !pred ) throw std::runtime_error( msg );
+#endif
+    }
+
+    namespace testing {
+        /**
+         *  Run `fn` expecting a failed check, returns its message (empty when every check passed).
+         *
+         *  Example:
+         *  @code
+         *  REQUIRE( eosio::testing::check_failure( [] { eosio::check(false, "error"); } ) == "error" );
+         *  @endcode
+         */
+        template <typename F>
+        std::string check_failure( F fn ) {
+            expecting_failure() = true;
+            try {
+                fn();
+            } catch ( const std::runtime_error& error ) {
+                expecting_failure() = false;
+                return error.what();
+            }
+            expecting_failure() = false;
+            return "";
+        }
     }
-}
\ No newline at end of file
+}
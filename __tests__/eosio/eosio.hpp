@@ -0,0 +1,7 @@
+#pragma once
+
+#include "check.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+#include "asset.hpp"
+#include "multi_index.hpp"
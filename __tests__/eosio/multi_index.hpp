@@ -0,0 +1,112 @@
+#pragma once
+
+#include <iterator>
+#include <map>
+
+#include "testing.hpp"
+
+namespace eosio {
+    /**
+     *  Local stand-in of `eosio::multi_index` (read-only, primary index)
+     *
+     *  Rows come from `eosio::testing` fixtures; `get` / `find` / iteration are counted like the chain intrinsics
+     *  and decoded rows are cached per table object, as on chain.
+     */
+    template <name::raw TableName, typename T>
+    class multi_index {
+    public:
+        typedef T value_type;
+
+        class const_iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const T* pointer;
+            typedef const T& reference;
+
+            const_iterator() = default;
+            const_iterator( const multi_index* table, std::map<uint64_t, testing::json>::const_iterator itr ) : _table( table ), _itr( itr ) {}
+
+            const T& operator*() const { return _table->load( _itr->first, _itr->second ); }
+            const T* operator->() const { return &**this; }
+
+            const_iterator& operator++()
+            {
+                testing::db().stats.nexts += 1;
+                ++_itr;
+                return *this;
+            }
+            const_iterator operator++( int )
+            {
+                const_iterator res = *this;
+                ++*this;
+                return res;
+            }
+
+            friend bool operator==( const const_iterator& a, const const_iterator& b ) { return a._itr == b._itr; }
+            friend bool operator!=( const const_iterator& a, const const_iterator& b ) { return a._itr != b._itr; }
+
+        private:
+            const multi_index*                                  _table = nullptr;
+            std::map<uint64_t, testing::json>::const_iterator   _itr;
+        };
+
+        multi_index( const name code, const uint64_t scope ) : _code( code ), _scope( scope ) {}
+
+        static constexpr name table_name() { return name( TableName ); }
+
+        static uint64_t primary_key_of( const testing::json& row )
+        {
+            T obj;
+            from_json( row, obj );
+            return obj.primary_key();
+        }
+
+        name get_code() const { return _code; }
+        uint64_t get_scope() const { return _scope; }
+
+        const_iterator begin() const
+        {
+            testing::db().stats.finds += 1;
+            return const_iterator( this, rows().begin() );
+        }
+        const_iterator end() const { return const_iterator( this, rows().end() ); }
+
+        const_iterator find( const uint64_t primary ) const
+        {
+            testing::db().stats.finds += 1;
+            return const_iterator( this, rows().find( primary ) );
+        }
+
+        const T& get( const uint64_t primary, const char* error_msg = "unable to find key" ) const
+        {
+            const const_iterator itr = find( primary );
+            check( itr != end(), error_msg );
+            return *itr;
+        }
+
+    private:
+        const std::map<uint64_t, testing::json>& rows() const
+        {
+            static const std::map<uint64_t, testing::json> empty;
+            const std::map<uint64_t, testing::json>* res = testing::rows( _code, _scope, table_name() );
+            return res ? *res : empty;
+        }
+
+        const T& load( const uint64_t primary, const testing::json& row ) const
+        {
+            const auto itr = _items.find( primary );
+            if ( itr != _items.end() ) return itr->second;
+
+            testing::db().stats.gets += 1;
+            T obj;
+            from_json( row, obj );
+            return _items.emplace( primary, std::move( obj ) ).first->second;
+        }
+
+        name                            _code;
+        uint64_t                        _scope;
+        mutable std::map<uint64_t, T>   _items;
+    };
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace eosio {
+    /**
+     *  Local stand-in of `eosio::name` (base32 encoded 64-bit account/table name)
+     *
+     *  Same encoding as the CDT: up to 12 characters of `.12345a-z`, plus a 13th character of `.1-5a-j`.
+     */
+    struct name {
+        enum class raw : uint64_t {};
+
+        uint64_t value = 0;
+
+        constexpr name() = default;
+        constexpr explicit name( uint64_t v ) : value( v ) {}
+        constexpr name( name::raw r ) : value( static_cast<uint64_t>(r) ) {}
+        constexpr explicit name( std::string_view str )
+        {
+            for ( size_t i = 0; i < 12 && i < str.size(); ++i ) {
+                value |= (char_to_value( str[i] ) & 0x1f) << (64 - 5 * (i + 1));
+            }
+            if ( str.size() > 12 ) value |= char_to_value( str[12] ) & 0x0f;
+        }
+
+        static constexpr uint64_t char_to_value( char c )
+        {
+            if ( c >= 'a' && c <= 'z' ) return (c - 'a') + 6;
+            if ( c >= '1' && c <= '5' ) return (c - '1') + 1;
+            return 0;
+        }
+
+        constexpr operator raw() const { return raw( value ); }
+        constexpr explicit operator bool() const { return value != 0; }
+
+        std::string to_string() const
+        {
+            static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+            std::string str( 13, '.' );
+            uint64_t tmp = value;
+            for ( uint32_t i = 0; i <= 12; ++i ) {
+                const char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+                str[12 - i] = c;
+                tmp >>= (i == 0 ? 4 : 5);
+            }
+            while ( !str.empty() && str.back() == '.' ) str.pop_back();
+            return str;
+        }
+
+        friend constexpr bool operator==( const name a, const name b ) { return a.value == b.value; }
+        friend constexpr bool operator!=( const name a, const name b ) { return a.value != b.value; }
+        friend constexpr bool operator<( const name a, const name b ) { return a.value < b.value; }
+    };
+
+    inline namespace literals {
+        constexpr name operator""_n( const char* str, size_t size ) { return name( std::string_view( str, size ) ); }
+    }
+}
+
+using namespace eosio::literals;
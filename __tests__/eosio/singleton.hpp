@@ -0,0 +1,37 @@
+#pragma once
+
+#include "multi_index.hpp"
+
+namespace eosio {
+    /**
+     *  Local stand-in of `eosio::singleton` (read-only, one row stored under the table name)
+     */
+    template <name::raw SingletonName, typename T>
+    class singleton {
+    public:
+        singleton( const name code, const uint64_t scope ) : _code( code ), _scope( scope ) {}
+
+        static constexpr name table_name() { return name( SingletonName ); }
+        static uint64_t primary_key_of( const testing::json& ) { return static_cast<uint64_t>(SingletonName); }
+
+        bool exists() const
+        {
+            testing::db().stats.finds += 1;
+            const auto* rows = testing::rows( _code, _scope, table_name() );
+            return rows && rows->count( primary_key_of( testing::json{} ) );
+        }
+
+        T get() const
+        {
+            check( exists(), "singleton does not exist" );
+            testing::db().stats.gets += 1;
+            T res;
+            from_json( testing::rows( _code, _scope, table_name() )->at( primary_key_of( testing::json{} ) ), res );
+            return res;
+        }
+
+    private:
+        name        _code;
+        uint64_t    _scope;
+    };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "check.hpp"
+
+namespace eosio {
+    /**
+     *  Local stand-in of `eosio::symbol_code` (up to 7 upper case characters packed in 64 bits)
+     */
+    struct symbol_code {
+        uint64_t value = 0;
+
+        constexpr symbol_code() = default;
+        constexpr explicit symbol_code( uint64_t raw ) : value( raw ) {}
+        constexpr symbol_code( std::string_view str )
+        {
+            for ( size_t i = 0; i < str.size() && i < 7; ++i ) value |= static_cast<uint64_t>(static_cast<uint8_t>(str[i])) << (8 * i);
+        }
+        constexpr symbol_code( const char* str ) : symbol_code( std::string_view( str ) ) {}
+
+        constexpr uint64_t raw() const { return value; }
+        constexpr explicit operator bool() const { return value != 0; }
+
+        std::string to_string() const
+        {
+            std::string str;
+            for ( uint64_t tmp = value; tmp; tmp >>= 8 ) str += static_cast<char>(tmp & 0xff);
+            return str;
+        }
+
+        friend constexpr bool operator==( const symbol_code a, const symbol_code b ) { return a.value == b.value; }
+        friend constexpr bool operator!=( const symbol_code a, const symbol_code b ) { return a.value != b.value; }
+        friend constexpr bool operator<( const symbol_code a, const symbol_code b ) { return a.value < b.value; }
+    };
+
+    /**
+     *  Local stand-in of `eosio::symbol` (symbol code << 8 | precision)
+     */
+    struct symbol {
+        uint64_t value = 0;
+
+        constexpr symbol() = default;
+        constexpr explicit symbol( uint64_t raw ) : value( raw ) {}
+        constexpr symbol( const symbol_code code, const uint8_t precision ) : value( code.raw() << 8 | precision ) {}
+        constexpr symbol( std::string_view code, const uint8_t precision ) : symbol( symbol_code( code ), precision ) {}
+
+        constexpr uint64_t raw() const { return value; }
+        constexpr uint8_t precision() const { return static_cast<uint8_t>(value & 0xff); }
+        constexpr symbol_code code() const { return symbol_code( value >> 8 ); }
+
+        friend constexpr bool operator==( const symbol a, const symbol b ) { return a.value == b.value; }
+        friend constexpr bool operator!=( const symbol a, const symbol b ) { return a.value != b.value; }
+        friend constexpr bool operator<( const symbol a, const symbol b ) { return a.value < b.value; }
+    };
+}
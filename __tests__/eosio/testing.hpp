@@ -0,0 +1,289 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+#include "asset.hpp"
+
+/**
+ *  In-memory chain state backing the local `multi_index` / `singleton` / `eosio::token` stand-ins
+ *
+ *  Rows are kept as JSON (the `get_table_rows` format) and decoded on every table read, the way contracts
+ *  deserialize rows on chain; every database call is counted so tests can assert lookup counts.
+ */
+namespace eosio {
+namespace testing {
+
+    // fixture errors (not contract assertions)
+    inline void expect( bool pred, const char* msg )
+    {
+        if ( !pred ) throw std::runtime_error( msg );
+    }
+
+    /**
+     *  Minimal JSON value (numbers are kept as text to preserve 64-bit integers)
+     */
+    struct json {
+        enum class type { null, boolean, number, string, array, object };
+
+        type                                        kind = type::null;
+        bool                                        flag = false;
+        std::string                                 text;
+        std::vector<json>                           items;
+        std::vector<std::pair<std::string, json>>   fields;
+
+        const json* find( std::string_view key ) const
+        {
+            for ( const auto& field : fields ) {
+                if ( field.first == key ) return &field.second;
+            }
+            return nullptr;
+        }
+
+        const json& operator[]( std::string_view key ) const
+        {
+            const json* res = find( key );
+            expect( res != nullptr, "testing: json field does not exist" );
+            return *res;
+        }
+
+        static json parse( std::string_view str )
+        {
+            size_t pos = 0;
+            json res = parse_value( str, pos );
+            skip( str, pos );
+            expect( pos == str.size(), "testing: invalid json" );
+            return res;
+        }
+
+        static json parse_file( const std::string& path )
+        {
+            std::ifstream file( path );
+            expect( file.good(), "testing: fixture file not found" );
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            return parse( buffer.str() );
+        }
+
+    private:
+        static void skip( std::string_view str, size_t& pos )
+        {
+            while ( pos < str.size() && (str[pos] == ' ' || str[pos] == '\n' || str[pos] == '\r' || str[pos] == '\t') ) ++pos;
+        }
+
+        static bool consume( std::string_view str, size_t& pos, std::string_view token )
+        {
+            if ( str.substr( pos, token.size() ) != token ) return false;
+            pos += token.size();
+            return true;
+        }
+
+        static std::string parse_string( std::string_view str, size_t& pos )
+        {
+            expect( consume( str, pos, "\"" ), "testing: invalid json string" );
+            std::string res;
+            while ( pos < str.size() && str[pos] != '"' ) {
+                char c = str[pos++];
+                if ( c == '\\' && pos < str.size() ) {
+                    c = str[pos++];
+                    if ( c == 'n' ) c = '\n';
+                    else if ( c == 't' ) c = '\t';
+                }
+                res += c;
+            }
+            expect( consume( str, pos, "\"" ), "testing: invalid json string" );
+            return res;
+        }
+
+        static json parse_value( std::string_view str, size_t& pos )
+        {
+            json res;
+            skip( str, pos );
+            expect( pos < str.size(), "testing: invalid json" );
+
+            if ( str[pos] == '{' ) {
+                res.kind = type::object;
+                ++pos;
+                skip( str, pos );
+                if ( consume( str, pos, "}" ) ) return res;
+                do {
+                    skip( str, pos );
+                    std::string key = parse_string( str, pos );
+                    skip( str, pos );
+                    expect( consume( str, pos, ":" ), "testing: invalid json object" );
+                    res.fields.emplace_back( std::move( key ), parse_value( str, pos ) );
+                    skip( str, pos );
+                } while ( consume( str, pos, "," ) );
+                expect( consume( str, pos, "}" ), "testing: invalid json object" );
+            } else if ( str[pos] == '[' ) {
+                res.kind = type::array;
+                ++pos;
+                skip( str, pos );
+                if ( consume( str, pos, "]" ) ) return res;
+                do {
+                    res.items.push_back( parse_value( str, pos ) );
+                    skip( str, pos );
+                } while ( consume( str, pos, "," ) );
+                expect( consume( str, pos, "]" ), "testing: invalid json array" );
+            } else if ( str[pos] == '"' ) {
+                res.kind = type::string;
+                res.text = parse_string( str, pos );
+            } else if ( consume( str, pos, "true" ) ) {
+                res.kind = type::boolean;
+                res.flag = true;
+            } else if ( consume( str, pos, "false" ) ) {
+                res.kind = type::boolean;
+            } else if ( consume( str, pos, "null" ) ) {
+                res.kind = type::null;
+            } else {
+                res.kind = type::number;
+                while ( pos < str.size() && (str[pos] == '-' || (str[pos] >= '0' && str[pos] <= '9')) ) res.text += str[pos++];
+                expect( !res.text.empty(), "testing: invalid json value" );
+            }
+            return res;
+        }
+    };
+
+    /**
+     *  Database call counters (same granularity as the chain intrinsics)
+     *
+     *  - `finds` - `db_find` / `db_lowerbound` (get, find, begin, singleton exists/get)
+     *  - `nexts` - `db_next` (iterator increments)
+     *  - `gets` - `db_get` (rows deserialized)
+     */
+    struct counters {
+        uint64_t finds = 0;
+        uint64_t nexts = 0;
+        uint64_t gets = 0;
+
+        uint64_t reads() const { return finds + nexts; }
+    };
+
+    struct table_id {
+        uint64_t code;
+        uint64_t scope;
+        uint64_t table;
+
+        friend bool operator<( const table_id& a, const table_id& b )
+        {
+            if ( a.code != b.code ) return a.code < b.code;
+            if ( a.scope != b.scope ) return a.scope < b.scope;
+            return a.table < b.table;
+        }
+    };
+
+    struct database {
+        std::map<table_id, std::map<uint64_t, json>>    tables;
+        testing::counters                               stats;
+    };
+
+    inline database& db()
+    {
+        static database instance;
+        return instance;
+    }
+
+    // rows of a table, nullptr when the table is empty
+    inline const std::map<uint64_t, json>* rows( const name code, const uint64_t scope, const name table )
+    {
+        const auto itr = db().tables.find( table_id{ code.value, scope, table.value } );
+        return itr == db().tables.end() ? nullptr : &itr->second;
+    }
+
+    inline void set_row( const name code, const uint64_t scope, const name table, const uint64_t primary_key, const json& row )
+    {
+        db().tables[ table_id{ code.value, scope, table.value } ][ primary_key ] = row;
+    }
+
+    inline const testing::counters& stats() { return db().stats; }
+    inline void reset_stats() { db().stats = testing::counters{}; }
+    inline void reset() { db() = database{}; }
+
+    /**
+     *  Load every fixture entry of a table type
+     *
+     *  Fixtures are an array of `{ "code", "scope", "table", "rows" }` entries; `Table` is a `multi_index` or `singleton` type.
+     *
+     *  ```c++
+     *  const auto fixtures = eosio::json::parse_file( "__tests__/fixtures/bancor.json" );
+     *  eosio::testing::load<bancor::multi::converter>( fixtures );
+     *  ```
+     */
+    template <typename Table>
+    void load( const json& fixtures )
+    {
+        for ( const json& entry : fixtures.items ) {
+            if ( name( entry["table"].text ) != name( Table::table_name() ) ) continue;
+            const name code = name( entry["code"].text );
+            const uint64_t scope = name( entry["scope"].text ).value;
+            for ( const json& row : entry["rows"].items ) {
+                set_row( code, scope, name( Table::table_name() ), Table::primary_key_of( row ), row );
+            }
+        }
+    }
+
+    /**
+     *  JSON decoders of the chain types (`get_table_rows` format), found by argument dependent lookup on `json`
+     */
+    inline void from_json( const json& value, uint64_t& res ) { res = std::strtoull( value.text.c_str(), nullptr, 10 ); }
+    inline void from_json( const json& value, int64_t& res ) { res = std::strtoll( value.text.c_str(), nullptr, 10 ); }
+    inline void from_json( const json& value, bool& res ) { res = value.flag; }
+    inline void from_json( const json& value, std::string& res ) { res = value.text; }
+    inline void from_json( const json& value, name& res ) { res = name( value.text ); }
+    inline void from_json( const json& value, symbol_code& res ) { res = symbol_code( value.text ); }
+
+    // "4,EOSBNT"
+    inline void from_json( const json& value, symbol& res )
+    {
+        const size_t comma = value.text.find( ',' );
+        expect( comma != std::string::npos, "testing: invalid symbol" );
+        res = symbol( std::string_view( value.text ).substr( comma + 1 ), static_cast<uint8_t>(std::atoi( value.text.c_str() )) );
+    }
+
+    // "58647.1775 EOS"
+    inline void from_json( const json& value, asset& res )
+    {
+        const std::string& str = value.text;
+        const size_t space = str.find( ' ' );
+        expect( space != std::string::npos, "testing: invalid asset" );
+        const std::string number = str.substr( 0, space );
+        const size_t dot = number.find( '.' );
+        const uint8_t precision = dot == std::string::npos ? 0 : static_cast<uint8_t>(number.size() - dot - 1);
+
+        std::string digits = number;
+        if ( dot != std::string::npos ) digits.erase( dot, 1 );
+        res = asset( std::strtoll( digits.c_str(), nullptr, 10 ), symbol( std::string_view( str ).substr( space + 1 ), precision ) );
+    }
+
+    inline void from_json( const json& value, extended_asset& res )
+    {
+        from_json( value["quantity"], res.quantity );
+        from_json( value["contract"], res.contract );
+    }
+
+    // [{ "key": ..., "value": ... }]
+    template <typename K, typename V>
+    void from_json( const json& value, std::map<K, V>& res )
+    {
+        res.clear();
+        for ( const json& item : value.items ) {
+            K key;
+            V val;
+            from_json( item["key"], key );
+            from_json( item["value"], val );
+            res.emplace( std::move( key ), std::move( val ) );
+        }
+    }
+}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <eosio/testing.hpp>
+
+/**
+ *  JSON decoders of the converter tables, used to seed the local chain from `__tests__/fixtures/bancor.json`
+ */
+namespace bancor {
+namespace multi {
+    inline void from_json( const eosio::testing::json& value, converter_row& row )
+    {
+        from_json( value["currency"], row.currency );
+        from_json( value["owner"], row.owner );
+        from_json( value["fee"], row.fee );
+        from_json( value["reserve_weights"], row.reserve_weights );
+        from_json( value["reserve_balances"], row.reserve_balances );
+        from_json( value["protocol_features"], row.protocol_features );
+        from_json( value["metadata_json"], row.metadata_json );
+    }
+
+    inline void from_json( const eosio::testing::json& value, flat_row& row )
+    {
+        converter_row full;
+        from_json( value, full );
+        row = to_flat( full );
+    }
+
+    inline void from_json( const eosio::testing::json& value, settings_row& row )
+    {
+        from_json( value["max_fee"], row.max_fee );
+        from_json( value["multi_token"], row.multi_token );
+        from_json( value["network"], row.network );
+        from_json( value["staking"], row.staking );
+    }
+}
+
+namespace legacy {
+    inline void from_json( const eosio::testing::json& value, settings_row& row )
+    {
+        from_json( value["smart_contract"], row.smart_contract );
+        from_json( value["smart_currency"], row.smart_currency );
+        from_json( value["smart_enabled"], row.smart_enabled );
+        from_json( value["enabled"], row.enabled );
+        from_json( value["network"], row.network );
+        from_json( value["require_balance"], row.require_balance );
+        from_json( value["max_fee"], row.max_fee );
+        from_json( value["fee"], row.fee );
+    }
+
+    inline void from_json( const eosio::testing::json& value, reserves_row& row )
+    {
+        from_json( value["contract"], row.contract );
+        from_json( value["currency"], row.currency );
+        from_json( value["ratio"], row.ratio );
+        from_json( value["p_enabled"], row.p_enabled );
+    }
+
+    inline void from_json( const eosio::testing::json& value, accounts_row& row )
+    {
+        from_json( value["balance"], row.balance );
+    }
+}
+
+/**
+ *  Fixture file next to this header (`-DBANCOR_FIXTURES="..."` overrides it), so tests run from any directory
+ */
+inline std::string fixtures_path()
+{
+#ifdef BANCOR_FIXTURES
+    return BANCOR_FIXTURES;
+#else
+    const std::string header = __FILE__;
+    return header.substr( 0, header.find_last_of( '/' ) + 1 ) + "bancor.json";
+#endif
+}
+
+/**
+ *  Reset the local chain and load every converter fixture
+ */
+inline void load_fixtures( const std::string& path = fixtures_path() )
+{
+    const eosio::testing::json fixtures = eosio::testing::json::parse_file( path );
+    eosio::testing::reset();
+    eosio::testing::load<bancor::multi::converter>( fixtures );
+    eosio::testing::load<bancor::legacy::settings>( fixtures );
+    eosio::testing::load<bancor::legacy::reserves>( fixtures );
+    eosio::testing::load<bancor::legacy::accounts>( fixtures );
+    eosio::testing::reset_stats();
+}
+}
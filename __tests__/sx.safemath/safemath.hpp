@@ -1,6 +1,24 @@
 #pragma once
 
+/**
+ * 128-bit backend
+ *
+ * - native `unsigned __int128` when the compiler supports it (default)
+ * - portable `uint128_t` class otherwise, or when `SAFEMATH_UINT128_CLASS` is defined (must be declared before this header)
+ */
+#if defined(__SIZEOF_INT128__) && !defined(SAFEMATH_UINT128_CLASS)
+#define SAFEMATH_NATIVE_UINT128 1
+#else
+#define SAFEMATH_NATIVE_UINT128 0
+#endif
+
 namespace safemath {
+#if SAFEMATH_NATIVE_UINT128
+    typedef unsigned __int128 uint128_t;
+#else
+    typedef ::uint128_t uint128_t;
+#endif
+
     /**
      * ## STATIC `add`
      *
@@ -57,8 +75,8 @@ namespace safemath {
      * ```
      */
     static uint128_t mul(const uint64_t x, const uint64_t y) {
-        const uint128_t z = static_cast<uint128_t>(x) * y;
-        eosio::check(y == 0 || z / y == x, "safemath-mul-overflow"); return z;
+        // 64 x 64 bit product always fits in 128 bits (no overflow check required)
+        return static_cast<uint128_t>(x) * y;
     }
 
     /**
@@ -80,4 +98,92 @@ namespace safemath {
         eosio::check(y > 0, "safemath-divide-zero");
         return x / y;
     }
+
+    /**
+     * ## ENUM `rounding`
+     *
+     * Rounding direction of `mul_div`
+     */
+    enum class rounding { down, up };
+
+    /**
+     * ## STATIC `mul_div`
+     *
+     * Computes `x * y / z` with a full precision intermediate (128-bit, or 192-bit when `y >= 2^64`) and a single division
+     *
+     * ### params
+     *
+     * - `{uint64_t} x`
+     * - `{uint128_t} y`
+     * - `{uint128_t} z`
+     * - `{rounding} [mode=rounding::down]` - floor or ceil of the exact quotient
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t z = safemath::mul_div(10000, 125682033533, 45851931234);
+     * //=> 27410
+     * const uint64_t w = safemath::mul_div(10000, 125682033533, 45851931234, safemath::rounding::up);
+     * //=> 27411
+     * ```
+     */
+    static uint64_t mul_div( const uint64_t x, const uint128_t y, const uint128_t z, const rounding mode = rounding::down ) {
+        eosio::check( z > 0, "safemath-divide-zero");
+
+        const uint64_t y1 = static_cast<uint64_t>(y >> 64);
+        const uint64_t y0 = static_cast<uint64_t>(y);
+        uint64_t q = 0;
+        bool exact = true;
+
+        if ( !y1 ) {
+            // 128-bit product
+            const uint128_t p = static_cast<uint128_t>(x) * y0;
+            const uint128_t quotient = p / z;
+            eosio::check( quotient >> 64 == 0, "safemath-muldiv-overflow");
+            q = static_cast<uint64_t>(quotient);
+            exact = quotient * z == p;
+        } else {
+            // 192-bit product p = p21 * 2^64 + p0
+            const uint128_t lo = static_cast<uint128_t>(x) * y0;
+            const uint128_t p21 = static_cast<uint128_t>(x) * y1 + (lo >> 64);
+            const uint64_t p0 = static_cast<uint64_t>(lo);
+
+            // quotient fits in 64 bits <=> p21 < z
+            eosio::check( p21 < z, "safemath-muldiv-overflow");
+
+            if ( z >> 64 == 0 ) {
+                const uint128_t n = (p21 << 64) | p0;
+                q = static_cast<uint64_t>(n / z);
+                exact = q * z == n;
+            } else {
+                // normalize z (top bit set), estimate the quotient from the top words (Knuth algorithm D: at most 2 corrections)
+                const uint8_t s = __builtin_clzll(static_cast<uint64_t>(z >> 64));
+                const uint128_t zn = z << s;
+                const uint128_t top = s ? (p21 << s) | (p0 >> (64 - s)) : p21;
+                const uint64_t low = p0 << s;
+
+                const uint128_t estimate = top / static_cast<uint64_t>(zn >> 64);
+                q = estimate >> 64 ? UINT64_MAX : static_cast<uint64_t>(estimate);
+
+                // m = q * zn = m1 * 2^64 + m0
+                const uint128_t m_lo = static_cast<uint128_t>(q) * static_cast<uint64_t>(zn);
+                uint128_t m1 = static_cast<uint128_t>(q) * static_cast<uint64_t>(zn >> 64) + (m_lo >> 64);
+                uint64_t m0 = static_cast<uint64_t>(m_lo);
+
+                while ( m1 > top || (m1 == top && m0 > low) ) {
+                    const uint64_t zn0 = static_cast<uint64_t>(zn);
+                    m1 -= (zn >> 64) + (m0 < zn0 ? 1 : 0);
+                    m0 -= zn0;
+                    q -= 1;
+                }
+                exact = m1 == top && m0 == low;
+            }
+        }
+
+        if ( mode == rounding::up && !exact ) {
+            eosio::check( q < UINT64_MAX, "safemath-muldiv-overflow");
+            q += 1;
+        }
+        return q;
+    }
 }
\ No newline at end of file
@@ -284,6 +284,57 @@ void uint128_t::export_bits(std::vector<uint8_t> &ret) const {
     ConvertToVector(ret, const_cast<const uint64_t&>(LOWER));
 }
 
+// number of leading zeros of a non-zero 64 bit value
+static uint8_t nlz64(uint64_t x){
+#if defined(__GNUC__)
+    return static_cast<uint8_t>(__builtin_clzll(x));
+#else
+    uint8_t n = 0;
+    if (x <= 0x00000000FFFFFFFFULL) { n += 32; x <<= 32; }
+    if (x <= 0x0000FFFFFFFFFFFFULL) { n += 16; x <<= 16; }
+    if (x <= 0x00FFFFFFFFFFFFFFULL) { n +=  8; x <<=  8; }
+    if (x <= 0x0FFFFFFFFFFFFFFFULL) { n +=  4; x <<=  4; }
+    if (x <= 0x3FFFFFFFFFFFFFFFULL) { n +=  2; x <<=  2; }
+    if (x <= 0x7FFFFFFFFFFFFFFFULL) { n +=  1; }
+    return n;
+#endif
+}
+
+// (u1 * 2^64 + u0) / v for u1 < v: normalized Knuth algorithm D with 32 bit digits (Hacker's Delight divlu)
+static uint64_t divlu(const uint64_t u1, const uint64_t u0, uint64_t v, uint64_t & r){
+    const uint64_t b = 0x100000000ULL;
+    const uint8_t s = nlz64(v);
+
+    v <<= s;
+    const uint64_t vn1 = v >> 32;
+    const uint64_t vn0 = v & 0xFFFFFFFFULL;
+
+    const uint64_t un32 = s ? (u1 << s) | (u0 >> (64 - s)) : u1;
+    const uint64_t un10 = u0 << s;
+    const uint64_t un1 = un10 >> 32;
+    const uint64_t un0 = un10 & 0xFFFFFFFFULL;
+
+    uint64_t q1 = un32 / vn1;
+    uint64_t rhat = un32 - q1 * vn1;
+    while (q1 >= b || q1 * vn0 > b * rhat + un1){
+        q1--;
+        rhat += vn1;
+        if (rhat >= b) break;
+    }
+
+    const uint64_t un21 = un32 * b + un1 - q1 * v;
+    uint64_t q0 = un21 / vn1;
+    rhat = un21 - q0 * vn1;
+    while (q0 >= b || q0 * vn0 > b * rhat + un0){
+        q0--;
+        rhat += vn1;
+        if (rhat >= b) break;
+    }
+
+    r = (un21 * b + un0 - q0 * v) >> s;
+    return q1 * b + q0;
+}
+
 std::pair <uint128_t, uint128_t> uint128_t::divmod(const uint128_t & lhs, const uint128_t & rhs) const{
     // Save some calculations /////////////////////
     if (rhs == uint128_0){
@@ -299,21 +350,27 @@ std::pair <uint128_t, uint128_t> uint128_t::divmod(const uint128_t & lhs, const
         return std::pair <uint128_t, uint128_t> (uint128_0, lhs);
     }
 
-    std::pair <uint128_t, uint128_t> qr (uint128_0, uint128_0);
-    for(uint8_t x = lhs.bits(); x > 0; x--){
-        qr.first  <<= uint128_1;
-        qr.second <<= uint128_1;
-
-        if ((lhs >> (x - 1U)) & 1){
-            ++qr.second;
-        }
+    // 64 bit divisor: two 128 / 64 steps
+    if (!rhs.UPPER){
+        uint64_t r = 0;
+        const uint64_t q_upper = lhs.UPPER / rhs.LOWER;
+        const uint64_t q_lower = divlu(lhs.UPPER % rhs.LOWER, lhs.LOWER, rhs.LOWER, r);
+        return std::pair <uint128_t, uint128_t> (uint128_t(q_upper, q_lower), uint128_t(0, r));
+    }
 
-        if (qr.second >= rhs){
-            qr.second -= rhs;
-            ++qr.first;
-        }
+    // 128 bit divisor: quotient fits in 64 bits, estimate from the normalized top word then correct once
+    const uint8_t n = nlz64(rhs.UPPER);
+    const uint64_t v1 = (rhs << n).UPPER;
+    const uint128_t u = lhs >> 1;
+    uint64_t r = 0;
+    uint64_t q = divlu(u.UPPER, u.LOWER, v1, r) >> (63 - n);
+    if (q) q--;
+    uint128_t rem = lhs - rhs * uint128_t(0, q);
+    if (rem >= rhs){
+        q++;
+        rem -= rhs;
     }
-    return qr;
+    return std::pair <uint128_t, uint128_t> (uint128_t(0, q), rem);
 }
 
 uint128_t uint128_t::operator/(const uint128_t & rhs) const{
@@ -0,0 +1,8 @@
+#!/bin/bash
+set -e
+
+# compile (reference needs GCC libquadmath)
+g++ -std=c++17 -Wno-attributes -O2 -o bancor.accuracy.out bancor.accuracy.cpp -I __tests__ -lquadmath
+
+# accuracy versus speed of every kernel (cases, JSON results)
+./bancor.accuracy.out ${1:-1000000} bancor.accuracy.json
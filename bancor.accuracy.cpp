@@ -0,0 +1,241 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <quadmath.h>
+
+#include <eosio/check.hpp>
+#include <uint128_t/uint128_t.cpp>
+
+#include "bancor.hpp"
+#include "bancor.fast.hpp"
+
+/**
+ * Accuracy versus speed of the `get_amount_out` kernels
+ *
+ * Every kernel is evaluated over the same generated cases and compared with a 113-bit (`__float128`) reference,
+ * computed as `reserve_out * -expm1(-weight_ratio * log1p(amount_in / reserve_in)) * (1 - fee)^2` to avoid cancellation.
+ * A result overshoots (overpays) when it is greater than the reference.
+ *
+ * ```bash
+ * ./bancor.accuracy.out [cases=1000000] [results.json]
+ * ```
+ */
+static volatile uint64_t sink;
+
+struct input {
+    uint64_t    amount_in;
+    uint64_t    reserve_in;
+    uint64_t    reserve_weight_in;
+    uint64_t    reserve_out;
+    uint64_t    reserve_weight_out;
+    uint64_t    fee;
+};
+
+struct kernel {
+    const char*     name;
+    uint64_t        (*fn)( const input& );
+};
+
+struct report {
+    std::string     name;
+    double          max_error;          // output units
+    double          mean_error;         // output units
+    double          max_relative;       // |error| / reference, references >= 1
+    uint64_t        overshoots;
+    double          max_overshoot;      // output units
+    double          ns_per_op;
+};
+
+// 113-bit reference
+static __float128 reference( const input& in )
+{
+    const __float128 weight_ratio = static_cast<__float128>(in.reserve_weight_in) / in.reserve_weight_out;
+    const __float128 ratio = -expm1q( -weight_ratio * log1pq( static_cast<__float128>(in.amount_in) / in.reserve_in ) );
+    const __float128 fee = 1 - static_cast<__float128>(in.fee) / 1000000;
+    return in.reserve_out * ratio * fee * fee;
+}
+
+// saturating conversion of floating point kernels
+template <typename T>
+static uint64_t to_amount( const T value )
+{
+    if ( !(value > 0) ) return 0;
+    if ( value >= static_cast<T>(UINT64_MAX) ) return UINT64_MAX;
+    return static_cast<uint64_t>(value);
+}
+
+static uint64_t kernel_fixed( const input& in )
+{
+    return bancor::get_amount_out( in.amount_in, in.reserve_in, in.reserve_weight_in, in.reserve_out, in.reserve_weight_out, in.fee );
+}
+
+// fixed-point engine without the rational weight specializations
+static uint64_t kernel_fixed_log_exp( const input& in )
+{
+    const safemath::uint128_t ratio = bancor::formula::target_ratio( bancor::formula::curve::general, in.amount_in, in.reserve_in, in.reserve_weight_in, in.reserve_weight_out );
+    const uint64_t fee_factor = (bancor::formula::MAX_FEE - in.fee) * (bancor::formula::MAX_FEE - in.fee);
+    const uint64_t ratio_after_fee = safemath::mul_div( static_cast<uint64_t>(ratio), fee_factor, bancor::formula::MAX_FEE * bancor::formula::MAX_FEE );
+    return static_cast<uint64_t>(safemath::mul( ratio_after_fee, in.reserve_out ) >> 64);
+}
+
+static uint64_t kernel_double( const input& in )
+{
+    return bancor::get_amount_out_double( in.amount_in, in.reserve_in, in.reserve_weight_in, in.reserve_out, in.reserve_weight_out, in.fee );
+}
+
+// double, expm1 / log1p form
+static uint64_t kernel_double_expm1( const input& in )
+{
+    const double weight_ratio = static_cast<double>(in.reserve_weight_in) / in.reserve_weight_out;
+    const double ratio = -std::expm1( -weight_ratio * std::log1p( static_cast<double>(in.amount_in) / in.reserve_in ) );
+    const double fee = 1 - static_cast<double>(in.fee) / 1000000;
+    return to_amount( in.reserve_out * ratio * fee * fee );
+}
+
+static uint64_t kernel_long_double( const input& in )
+{
+    const long double weight_ratio = static_cast<long double>(in.reserve_weight_in) / in.reserve_weight_out;
+    const long double ratio = 1 - std::pow( static_cast<long double>(in.reserve_in) / (static_cast<long double>(in.reserve_in) + in.amount_in), weight_ratio );
+    const long double fee = 1 - static_cast<long double>(in.fee) / 1000000;
+    return to_amount( in.reserve_out * ratio * fee * fee );
+}
+
+static uint64_t kernel_fast_lower( const input& in )
+{
+    return bancor::fast::get_amount_out_interval( in.amount_in, in.reserve_in, in.reserve_weight_in, in.reserve_out, in.reserve_weight_out, in.fee ).lower;
+}
+
+static uint64_t kernel_fast_upper( const input& in )
+{
+    return bancor::fast::get_amount_out_interval( in.amount_in, in.reserve_in, in.reserve_weight_in, in.reserve_out, in.reserve_weight_out, in.fee ).upper;
+}
+
+// approximate: spot price, ignores slippage
+static uint64_t kernel_spot( const input& in )
+{
+    const uint64_t fee_factor = (bancor::formula::MAX_FEE - in.fee) * (bancor::formula::MAX_FEE - in.fee);
+    const safemath::uint128_t out = safemath::mul( in.amount_in, in.reserve_out ) / in.reserve_in * in.reserve_weight_in / in.reserve_weight_out;
+    if ( out > UINT64_MAX ) return UINT64_MAX;
+    return safemath::mul_div( static_cast<uint64_t>(out), fee_factor, bancor::formula::MAX_FEE * bancor::formula::MAX_FEE );
+}
+
+// deterministic inputs (xorshift64)
+static uint64_t next_random( uint64_t& state )
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// log-uniform in [10^lo, 10^hi]
+static double log_uniform( uint64_t& state, const double lo, const double hi )
+{
+    return std::pow( 10.0, lo + (hi - lo) * (next_random( state ) >> 11) * 0x1p-53 );
+}
+
+static std::vector<input> generate( const uint64_t count )
+{
+    static const uint64_t weights[][2] = { { 500000, 500000 }, { 800000, 200000 }, { 200000, 400000 }, { 600000, 400000 }, { 450000, 550000 } };
+    static const uint64_t fees[] = { 0, 2000, 30000 };
+
+    uint64_t state = 0x9E3779B97F4A7C15;
+    std::vector<input> res;
+    res.reserve( count );
+    while ( res.size() < count ) {
+        input in;
+        in.reserve_in = static_cast<uint64_t>(log_uniform( state, 4, 18 ));
+        in.reserve_out = static_cast<uint64_t>(log_uniform( state, 4, 18 ));
+        in.amount_in = std::max<uint64_t>( 1, static_cast<uint64_t>(in.reserve_in * log_uniform( state, -9, 1 )) );
+
+        // 1 in 6 cases uses arbitrary weights
+        const uint64_t w = next_random( state ) % 6;
+        in.reserve_weight_in = w < 5 ? weights[w][0] : 1 + next_random( state ) % bancor::formula::MAX_WEIGHT;
+        in.reserve_weight_out = w < 5 ? weights[w][1] : 1 + next_random( state ) % bancor::formula::MAX_WEIGHT;
+        in.fee = fees[next_random( state ) % 3];
+        res.push_back( in );
+    }
+    return res;
+}
+
+static report evaluate( const kernel& k, const std::vector<input>& cases, const std::vector<__float128>& expected )
+{
+    report res{ k.name, 0, 0, 0, 0, 0, 0 };
+    double sum = 0;
+    for ( size_t i = 0; i < cases.size(); ++i ) {
+        const uint64_t out = k.fn( cases[i] );
+        const double error = static_cast<double>(static_cast<__float128>(out) - expected[i]);
+        const double magnitude = std::fabs( error );
+
+        sum += magnitude;
+        if ( magnitude > res.max_error ) res.max_error = magnitude;
+        if ( expected[i] >= 1 && magnitude / static_cast<double>(expected[i]) > res.max_relative ) res.max_relative = magnitude / static_cast<double>(expected[i]);
+        if ( error > 0 ) {
+            res.overshoots += 1;
+            if ( error > res.max_overshoot ) res.max_overshoot = error;
+        }
+    }
+    res.mean_error = sum / cases.size();
+
+    // throughput
+    uint64_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for ( const input& in : cases ) checksum += k.fn( in );
+    const auto end = std::chrono::steady_clock::now();
+    res.ns_per_op = std::chrono::duration<double, std::nano>( end - start ).count() / cases.size();
+    sink = checksum;
+
+    return res;
+}
+
+static void write_json( const char* path, const std::vector<report>& reports, const uint64_t count )
+{
+    FILE* file = fopen( path, "w" );
+    eosio::check( file != nullptr, "accuracy: cannot open output file" );
+
+    fprintf( file, "{\n  \"cases\": %llu,\n  \"kernels\": [\n", static_cast<unsigned long long>(count) );
+    for ( size_t i = 0; i < reports.size(); ++i ) {
+        const report& r = reports[i];
+        fprintf( file, "    { \"name\": \"%s\", \"max_error\": %.6g, \"mean_error\": %.6g, \"max_relative_error\": %.6g, \"overshoots\": %llu, \"max_overshoot\": %.6g, \"ns_per_op\": %.2f }%s\n",
+                 r.name.c_str(), r.max_error, r.mean_error, r.max_relative, static_cast<unsigned long long>(r.overshoots), r.max_overshoot, r.ns_per_op, i + 1 < reports.size() ? "," : "" );
+    }
+    fprintf( file, "  ]\n}\n" );
+    fclose( file );
+}
+
+int main( int argc, char** argv )
+{
+    const uint64_t count = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 1000000;
+    const std::vector<input> cases = generate( count );
+
+    std::vector<__float128> expected( cases.size() );
+    for ( size_t i = 0; i < cases.size(); ++i ) expected[i] = reference( cases[i] );
+
+    const kernel kernels[] = {
+        { "fixed-point (get_amount_out)", kernel_fixed },
+        { "fixed-point (log/exp only)", kernel_fixed_log_exp },
+        { "double (get_amount_out_double)", kernel_double },
+        { "double (expm1/log1p)", kernel_double_expm1 },
+        { "long double (pow)", kernel_long_double },
+        { "approximate (fast lower bound)", kernel_fast_lower },
+        { "approximate (fast upper bound)", kernel_fast_upper },
+        { "approximate (spot price)", kernel_spot },
+    };
+
+    printf( "backend: %s, cases: %llu\n", SAFEMATH_NATIVE_UINT128 ? "unsigned __int128" : "uint128_t class", static_cast<unsigned long long>(count) );
+    printf( "%-32s %12s %12s %12s %12s %14s %10s\n", "kernel", "max err", "mean err", "max rel", "overshoots", "max overshoot", "ns/op" );
+
+    std::vector<report> reports;
+    for ( const kernel& k : kernels ) {
+        reports.push_back( evaluate( k, cases, expected ) );
+        const report& r = reports.back();
+        printf( "%-32s %12.4g %12.4g %12.3g %12llu %14.4g %10.1f\n", r.name.c_str(), r.max_error, r.mean_error, r.max_relative, static_cast<unsigned long long>(r.overshoots), r.max_overshoot, r.ns_per_op );
+    }
+
+    if ( argc > 2 ) write_json( argv[2], reports, count );
+    return 0;
+}
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <tuple>
+
+#include "bancor.graph.hpp"
+
+namespace bancor {
+
+    /**
+     * ## STATIC `get_optimal_amount_in`
+     *
+     * Given a route, returns the input amount maximizing `get_amount_out( path, amount_in ) - amount_in` (0 when no input is profitable)
+     *
+     * The route output `f` is concave, so the optimum solves `f'(a) = 1`; Newton's method is applied to `ln f'(a)`
+     * (convex & decreasing, so iterates approach the root from below), derivatives being chained through every hop.
+     * Neighbouring integers are then re-priced with the exact `get_amount_out`.
+     *
+     * ### params
+     *
+     * - `{route} path` - hops in trade order (a cycle: the last output is the first input)
+     *
+     * ### example
+     *
+     * ```c++
+     * // EOS => BNT (multi) => EOS (legacy)
+     * const bancor::route path = {
+     *     { 579884155, 500000, 2164526259891919, 500000, 2000 },
+     *     { 2042781014136003, 500000, 559884608, 500000, 2000 }
+     * };
+     * const uint64_t amount_in = bancor::get_optimal_amount_in( path );
+     * // => 2093209
+     * ```
+     */
+    static uint64_t get_optimal_amount_in( const bancor::route& path )
+    {
+        eosio::check(path.size > 0, "sx.bancor: INVALID_ROUTE");
+
+        // ln f'(a) and its derivative, one forward pass through the hops
+        const auto evaluate = [&]( const double amount, double& slope ) {
+            double x = amount, chain = 1, res = 0;
+            slope = 0;
+            for ( uint8_t i = 0; i < path.size; ++i ) {
+                const hop& item = path.hops[i];
+                const double reserve_in = static_cast<double>(item.reserve_in);
+                const double weight = static_cast<double>(item.reserve_weight_in) / item.reserve_weight_out;
+                const double fee = static_cast<double>(path.fee_factors[i]) * 1e-12;
+
+                // out = R_out * (1 - (R_in / (R_in + x))^w) * fee, out' = R_out * fee * w * (R_in / (R_in + x))^w / (R_in + x)
+                const double exponent = -weight * std::log1p( x / reserve_in );
+                const double derivative = static_cast<double>(item.reserve_out) * fee * weight * std::exp( exponent ) / (reserve_in + x);
+                res += std::log( derivative );
+                slope -= (weight + 1) / (reserve_in + x) * chain;
+                chain *= derivative;
+                x = -static_cast<double>(item.reserve_out) * fee * std::expm1( exponent );
+            }
+            return res;
+        };
+
+        double slope;
+        if ( !(evaluate( 0, slope ) > 0) ) return 0;
+
+        // Newton: a <- a - ln f'(a) / (ln f')'(a)
+        const double limit = static_cast<double>(UINT64_MAX / 2);
+        double amount = 0;
+        for ( uint8_t i = 0; i < 64; ++i ) {
+            const double value = evaluate( amount, slope );
+            const double step = -value / slope;
+            amount = std::min( amount + step, limit );
+            if ( !(step > 0.25) || amount >= limit ) break;
+        }
+
+        // integer neighbours, exact prices
+        uint64_t res = 0;
+        uint64_t best = 0;
+        const uint64_t center = static_cast<uint64_t>(amount);
+        for ( uint64_t candidate = center > 2 ? center - 2 : 1; candidate <= center + 2; ++candidate ) {
+            const uint64_t amount_out = bancor::get_amount_out( path, candidate );
+            if ( amount_out > candidate && amount_out - candidate > best ) {
+                best = amount_out - candidate;
+                res = candidate;
+            }
+        }
+        return res;
+    }
+
+    /**
+     * ## STRUCT `cycle`
+     *
+     * Profitable price cycle returned by `arbitrage`
+     *
+     * ### params
+     *
+     * - `{double} cost` - `-ln(spot rate after fees)` around the cycle (negative)
+     * - `{uint64_t} amount_in` - optimal input amount (`get_optimal_amount_in`, 0 when integer rounding leaves no profitable input)
+     * - `{uint64_t} amount_out` - exact output amount for `amount_in`
+     * - `{route} path` - hops in trade order (current reserves), starting and ending at `tokens[0]`
+     * - `{uint32_t[]} converters` - graph converter index of each hop
+     * - `{uint32_t[]} tokens` - graph token index of each hop input
+     * - `{bool} too_long` - more than `route::MAX_HOPS` hops: only `cost` is set (no path, not sized)
+     */
+    struct cycle {
+        double          cost = 0;
+        uint64_t        amount_in = 0;
+        uint64_t        amount_out = 0;
+        bool            too_long = false;
+        bancor::route   path;
+        uint32_t        converters[route::MAX_HOPS];
+        uint32_t        tokens[route::MAX_HOPS];
+    };
+
+    /**
+     * ## STRUCT `arbitrage`
+     *
+     * Negative `-ln(price)` cycle detector over a `bancor::graph`, kept up to date per converter update
+     *
+     * Token potentials are maintained with SPFA (queue based Bellman-Ford). Any negative cycle leaves at least one edge
+     * with a negative reduced cost, so after an update only the tokens of the changed converter are queued and relaxed;
+     * a relaxed token found among its own last predecessors (or a path longer than the token count) reveals a cycle.
+     * Reported cycles are suspended (their edges are skipped) until any of their converters is updated again.
+     * Cycles longer than `route::MAX_HOPS` cannot be traded as one route: they are reported with `too_long` set
+     * (cost only) and suspended like the others; cycles only profitable at the spot price are reported with `amount_in` 0.
+     *
+     * Each run stops after `max_relaxations`: the pending tokens are kept (potentials stay consistent), `exhausted` is set
+     * and `resume` continues the same search.
+     *
+     * ### params
+     *
+     * - `{graph} graph` - converter graph (owned)
+     * - `{uint64_t} [max_relaxations=0]` - relaxations per run (0: `tokens * (tokens + 1) * 4 + 64`)
+     * - `{bool} exhausted` - the last run stopped at `max_relaxations` with tokens pending
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::arbitrage engine;
+     * engine.load_multi();
+     * const vector<bancor::cycle> cycles = engine.load_legacy( "bnt2eoscnvrt"_n );
+     * // cycles[0] => EOS => BNT (EOSBNT) => EOS (bnt2eoscnvrt)
+     *
+     * // on every reserve change
+     * for ( const bancor::cycle& item : engine.update_multi( {"EOSBNT"} ) ) {
+     *     // trade item.path with item.amount_in
+     * }
+     * while ( engine.exhausted ) engine.resume();
+     * ```
+     */
+    struct arbitrage {
+        // minimum relaxation (and cycle cost), filters floating point noise
+        static constexpr double EPSILON = 1e-12;
+
+        bancor::graph   graph;
+        uint64_t        max_relaxations = 0;
+        bool            exhausted = false;
+
+        // add or refresh every converter of a multi converter contract
+        vector<bancor::cycle> load_multi( const name code = bancor::multi::code )
+        {
+            bancor::multi::converter_flat _converter( code, code.value );
+            for ( const auto& row : _converter ) touch( graph.set_multi( bancor::multi::load( row ), code ) );
+            return run();
+        }
+
+        // add or refresh a legacy converter account
+        vector<bancor::cycle> load_legacy( const name code )
+        {
+            return set_legacy( bancor::legacy::load( code ) );
+        }
+
+        // re-read one multi converter and re-relax its tokens only
+        vector<bancor::cycle> update_multi( const symbol_code currency, const name code = bancor::multi::code )
+        {
+            return set_multi( bancor::multi::load( currency, code ), code );
+        }
+
+        // re-read one legacy converter and re-relax its tokens only
+        vector<bancor::cycle> update_legacy( const name code )
+        {
+            return set_legacy( bancor::legacy::load( code ) );
+        }
+
+        // apply an already loaded multi converter (ex: streamed table deltas)
+        vector<bancor::cycle> set_multi( const bancor::multi::snapshot& snapshot, const name code = bancor::multi::code )
+        {
+            touch( graph.set_multi( snapshot, code ) );
+            return run();
+        }
+
+        // apply an already loaded legacy converter
+        vector<bancor::cycle> set_legacy( const bancor::legacy::snapshot& snapshot )
+        {
+            touch( graph.set_legacy( snapshot ) );
+            return run();
+        }
+
+        // continue an exhausted search (pending tokens only)
+        vector<bancor::cycle> resume()
+        {
+            return run();
+        }
+
+    private:
+        // predecessor edge of a token (stable across graph updates)
+        struct link {
+            int64_t     from = -1;
+            uint32_t    converter;
+            uint8_t     reserve_in;
+            uint8_t     reserve_out;
+        };
+
+        // (converter, reserve_in, reserve_out)
+        typedef std::tuple<uint32_t, uint8_t, uint8_t> edge_key;
+
+        static edge_key key( const uint32_t converter, const uint8_t reserve_in, const uint8_t reserve_out )
+        {
+            return edge_key( converter, reserve_in, reserve_out );
+        }
+
+        // resize the per-token state, queue the converter's tokens and lift its suspensions
+        void touch( const uint32_t converter )
+        {
+            const size_t size = graph.tokens.size();
+            _potential.resize( size, 0 );
+            _pred.resize( size );
+            _length.resize( size, 0 );
+            _queued.resize( size, false );
+
+            // lift every suspended cycle through this converter (and re-relax its tokens)
+            bool lifted = false;
+            for ( size_t i = _cycles.size(); i > 0; --i ) {
+                const vector<edge_key>& keys = _cycles[i - 1];
+                if ( std::none_of( keys.begin(), keys.end(), [&]( const edge_key& k ) { return std::get<0>(k) == converter; } ) ) continue;
+                for ( const edge_key& k : keys ) {
+                    const graph::converter& item = graph.converters[std::get<0>(k)];
+                    if ( std::get<1>(k) < item.size ) push( item.reserves[std::get<1>(k)].token );
+                }
+                _cycles.erase( _cycles.begin() + (i - 1) );
+                lifted = true;
+            }
+            if ( lifted ) {
+                _suspended.clear();
+                for ( const vector<edge_key>& keys : _cycles ) _suspended.insert( keys.begin(), keys.end() );
+            }
+
+            const graph::converter& item = graph.converters[converter];
+            for ( uint8_t i = 0; i < item.size; ++i ) push( item.reserves[i].token );
+        }
+
+        void push( const uint32_t token )
+        {
+            if ( _queued[token] ) return;
+            _queued[token] = true;
+            _queue.push_back( token );
+        }
+
+        bool suspended( const graph::edge& item ) const
+        {
+            return !_suspended.empty() && _suspended.count( key( item.converter, item.reserve_in, item.reserve_out ) );
+        }
+
+        // SPFA from the queued tokens
+        vector<bancor::cycle> run()
+        {
+            vector<bancor::cycle> res;
+            const uint32_t size = graph.tokens.size();
+            uint64_t budget = max_relaxations ? max_relaxations : static_cast<uint64_t>(size) * (size + 1) * 4 + 64;
+
+            size_t head = 0;
+            for ( ; head < _queue.size() && budget; ++head ) {
+                const uint32_t from = _queue[head];
+                _queued[from] = false;
+
+                for ( const graph::edge& item : graph.edges[from] ) {
+                    if ( _potential[from] + item.cost >= _potential[item.to] - EPSILON || suspended( item ) ) continue;
+
+                    // out of budget: relax the rest of `from` on resume
+                    if ( budget == 0 ) {
+                        push( from );
+                        break;
+                    }
+                    _potential[item.to] = _potential[from] + item.cost;
+                    _pred[item.to] = link{ from, item.converter, item.reserve_in, item.reserve_out };
+                    _length[item.to] = _length[from] + 1;
+                    budget -= 1;
+
+                    // short cycles: `to` is one of the last predecessors of `from`; longer ones: path longer than the token count
+                    int64_t ancestor = from;
+                    for ( uint8_t i = 1; i < route::MAX_HOPS && ancestor >= 0 && ancestor != item.to; ++i ) ancestor = _pred[ancestor].from;
+                    if ( ancestor == item.to || _length[item.to] >= size ) {
+                        bancor::cycle found;
+                        if ( extract( item.to, ancestor == item.to, found ) ) res.push_back( found );
+                        _length[item.to] = 0;
+                    }
+                    push( item.to );
+                }
+            }
+
+            // pending tokens stay queued for `resume`
+            exhausted = head < _queue.size();
+            _queue.erase( _queue.begin(), _queue.begin() + head );
+            return res;
+        }
+
+        // edge of a predecessor link, nullptr when it no longer exists
+        const graph::edge* resolve( const link& item ) const
+        {
+            if ( item.from < 0 ) return nullptr;
+            for ( const graph::edge& edge : graph.edges[item.from] ) {
+                if ( edge.converter == item.converter && edge.reserve_in == item.reserve_in && edge.reserve_out == item.reserve_out ) return &edge;
+            }
+            return nullptr;
+        }
+
+        // walk the predecessors of `token` into a cycle, verify & size it (flag it when too long), then suspend its edges
+        bool extract( const uint32_t token, const bool on_cycle, bancor::cycle& res )
+        {
+            // otherwise n steps back lands inside the cycle (if any)
+            int64_t start = token;
+            for ( size_t i = 0; !on_cycle && i < graph.tokens.size() && start >= 0; ++i ) start = _pred[start].from;
+            if ( start < 0 ) return false;
+
+            // collect the cycle backwards
+            vector<const graph::edge*> edges;
+            int64_t current = start;
+            do {
+                const graph::edge* item = resolve( _pred[current] );
+                if ( item == nullptr || suspended( *item ) || edges.size() >= graph.tokens.size() ) return false;
+                edges.push_back( item );
+                current = _pred[current].from;
+            } while ( current != start );
+
+            double cost = 0;
+            for ( const graph::edge* item : edges ) cost += item->cost;
+            if ( !(cost < -EPSILON) ) return false;
+
+            vector<edge_key> keys;
+            for ( const graph::edge* item : edges ) keys.push_back( key( item->converter, item->reserve_in, item->reserve_out ) );
+            _suspended.insert( keys.begin(), keys.end() );
+            _cycles.push_back( keys );
+
+            // trade order
+            res.cost = cost;
+            res.too_long = edges.size() > route::MAX_HOPS;
+            if ( res.too_long ) return true;
+            for ( size_t i = edges.size(); i > 0; --i ) {
+                const graph::edge* item = edges[i - 1];
+                const uint8_t index = res.path.size;
+                res.converters[index] = item->converter;
+                res.tokens[index] = graph.converters[item->converter].reserves[item->reserve_in].token;
+                res.path.push_back( graph.get_hop( *item ) );
+            }
+            res.amount_in = bancor::get_optimal_amount_in( res.path );
+            res.amount_out = res.amount_in ? bancor::get_amount_out( res.path, res.amount_in ) : 0;
+            return true;
+        }
+
+        vector<double>                                  _potential;
+        vector<link>                                    _pred;
+        vector<uint32_t>                                _length;
+        vector<bool>                                    _queued;
+        vector<uint32_t>                                _queue;
+        vector<vector<edge_key>>                        _cycles;        // suspended cycles
+        std::set<edge_key>                              _suspended;     // their edges
+    };
+}
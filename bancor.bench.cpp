@@ -0,0 +1,488 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <uint128_t/uint128_t.cpp>
+
+#include "bancor.hpp"
+#include "bancor.fast.hpp"
+#include "bancor.legacy.hpp"
+#include "bancor.multi.hpp"
+#include "bancor.graph.hpp"
+#include "bancor.arbitrage.hpp"
+#include "bancor.split.hpp"
+#include "bancor.pool.hpp"
+#include "bancor.server.hpp"
+#include "bancor.seqlock.hpp"
+#include "bancor.delta.hpp"
+#include "bancor.image.hpp"
+
+#include <fixtures/bancor.hpp>
+
+/**
+ * Microbenchmarks of the pricing functions
+ *
+ * Every case runs `SAMPLES` timed blocks of `BLOCK` calls over pre-generated inputs;
+ * ns/op and ops/s come from the total time, percentiles from the per-block averages.
+ *
+ * ```bash
+ * ./bancor.bench.out [results.json]
+ * ```
+ */
+static constexpr uint64_t SAMPLES = 2000;
+static constexpr uint64_t BLOCK = 64;
+static constexpr uint64_t INPUTS = 1024;
+
+static volatile uint64_t sink;
+
+struct result {
+    std::string     name;
+    double          ns_per_op;
+    double          ops_per_sec;
+    double          p50;
+    double          p90;
+    double          p99;
+    double          reads_per_op;   // < 0 when not measured
+};
+
+static std::vector<result> results;
+
+static double percentile( const std::vector<double>& sorted, const double p )
+{
+    const size_t index = static_cast<size_t>( p * (sorted.size() - 1) + 0.5 );
+    return sorted[index];
+}
+
+template <typename F>
+static result& bench( const std::string& name, F fn, const uint64_t samples = SAMPLES )
+{
+    std::vector<double> latency( samples );
+    uint64_t sum = 0, i = 0;
+
+    // warm-up
+    for ( uint64_t j = 0; j < BLOCK; ++j ) sum += fn( i++ );
+
+    const auto start = std::chrono::steady_clock::now();
+    for ( uint64_t s = 0; s < samples; ++s ) {
+        const auto block_start = std::chrono::steady_clock::now();
+        for ( uint64_t j = 0; j < BLOCK; ++j ) sum += fn( i++ );
+        latency[s] = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - block_start ).count() / BLOCK;
+    }
+    const double total = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+    sink = sum;
+
+    std::sort( latency.begin(), latency.end() );
+    const double ns = total / (samples * BLOCK);
+    results.push_back( result{ name, ns, 1e9 / ns, percentile( latency, 0.50 ), percentile( latency, 0.90 ), percentile( latency, 0.99 ), -1 } );
+
+    const result& res = results.back();
+    printf( "%-48s %10.1f ns/op %12.0f ops/s   p50 %8.1f  p90 %8.1f  p99 %8.1f\n", res.name.c_str(), res.ns_per_op, res.ops_per_sec, res.p50, res.p90, res.p99 );
+    return results.back();
+}
+
+// same as `bench`, plus table reads per call on the local chain
+template <typename F>
+static void bench_reads( const std::string& name, F fn )
+{
+    eosio::testing::reset_stats();
+    result& res = bench( name, fn, SAMPLES / 10 );
+    res.reads_per_op = static_cast<double>(eosio::testing::stats().reads()) / ((SAMPLES / 10 + 1) * BLOCK);
+    printf( "%-48s %10.1f reads/op\n", "", res.reads_per_op );
+}
+
+static void write_json( const char* path, const char* backend )
+{
+    FILE* file = fopen( path, "w" );
+    eosio::check( file != nullptr, "bench: cannot open output file" );
+
+    fprintf( file, "{\n  \"backend\": \"%s\",\n  \"samples\": %llu,\n  \"block\": %llu,\n  \"results\": [\n", backend, static_cast<unsigned long long>(SAMPLES), static_cast<unsigned long long>(BLOCK) );
+    for ( size_t i = 0; i < results.size(); ++i ) {
+        const result& res = results[i];
+        fprintf( file, "    { \"name\": \"%s\", \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f, \"p50_ns\": %.2f, \"p90_ns\": %.2f, \"p99_ns\": %.2f", res.name.c_str(), res.ns_per_op, res.ops_per_sec, res.p50, res.p90, res.p99 );
+        if ( res.reads_per_op >= 0 ) fprintf( file, ", \"reads_per_op\": %.2f", res.reads_per_op );
+        fprintf( file, " }%s\n", i + 1 < results.size() ? "," : "" );
+    }
+    fprintf( file, "  ]\n}\n" );
+    fclose( file );
+}
+
+// deterministic inputs (xorshift64)
+static uint64_t next_random( uint64_t& state )
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// value in [scale / 2, scale * 3 / 2)
+static uint64_t around( uint64_t& state, const uint64_t scale )
+{
+    return scale / 2 + next_random( state ) % scale;
+}
+
+struct pair_inputs {
+    uint64_t    amount_in[INPUTS];
+    uint64_t    amount_out[INPUTS];
+    uint64_t    reserve_in[INPUTS];
+    uint64_t    reserve_out[INPUTS];
+};
+
+int main( int argc, char** argv )
+{
+    const char* backend = SAFEMATH_NATIVE_UINT128 ? "unsigned __int128" : "uint128_t class";
+    printf( "backend: %s\n", backend );
+
+    // safemath
+    uint64_t state = 0x9E3779B97F4A7C15;
+    std::vector<uint64_t> x( INPUTS ), y( INPUTS ), z( INPUTS );
+    for ( uint64_t i = 0; i < INPUTS; ++i ) {
+        x[i] = next_random( state );
+        y[i] = next_random( state ) >> 8;
+        z[i] = (y[i] | 1) + (next_random( state ) >> 40);
+    }
+    const uint64_t mask = INPUTS - 1;
+    bench( "safemath::mul", [&]( uint64_t i ) { return static_cast<uint64_t>( safemath::mul( x[i & mask], y[i & mask] ) >> 32 ); } );
+    bench( "safemath::mul / uint64_t", [&]( uint64_t i ) { return static_cast<uint64_t>( safemath::mul( x[i & mask] >> 8, y[i & mask] ) / z[i & mask] ); } );
+    bench( "safemath::mul_div", [&]( uint64_t i ) { return safemath::mul_div( x[i & mask] >> 8, y[i & mask], z[i & mask] ); } );
+    bench( "safemath::mul_div (up)", [&]( uint64_t i ) { return safemath::mul_div( x[i & mask] >> 8, y[i & mask], z[i & mask], safemath::rounding::up ); } );
+
+    // portable uint128_t class division (128 / 64 and 128 / 128)
+    bench( "uint128_t class / uint64_t", [&]( uint64_t i ) { return static_cast<uint64_t>( ::uint128_t( x[i & mask] >> 8, y[i & mask] ) / z[i & mask] ); } );
+    bench( "uint128_t class % uint64_t", [&]( uint64_t i ) { return static_cast<uint64_t>( ::uint128_t( x[i & mask] >> 8, y[i & mask] ) % z[i & mask] ); } );
+    bench( "uint128_t class / uint128_t", [&]( uint64_t i ) { return static_cast<uint64_t>( ::uint128_t( x[i & mask], y[i & mask] ) / ::uint128_t( y[i & mask] >> 20, z[i & mask] ) ); } );
+
+    // pricing functions: reserve magnitudes 1e4..1e18, trades of ~0.1% of the reserve
+    const uint64_t weights[][2] = { { 500000, 500000 }, { 800000, 200000 }, { 450000, 550000 } };
+    const char* weight_names[] = { "500000/500000", "800000/200000", "450000/550000" };
+    const uint64_t magnitudes[] = { 10000ULL, 100000000ULL, 1000000000000ULL, 10000000000000000ULL, 1000000000000000000ULL };
+    const char* magnitude_names[] = { "1e4", "1e8", "1e12", "1e16", "1e18" };
+    static pair_inputs inputs;
+
+    for ( uint8_t m = 0; m < 5; ++m ) {
+        const uint64_t scale = magnitudes[m];
+        for ( uint64_t i = 0; i < INPUTS; ++i ) {
+            inputs.reserve_in[i] = around( state, scale );
+            inputs.reserve_out[i] = around( state, scale );
+            inputs.amount_in[i] = std::max<uint64_t>( 1, around( state, scale / 1000 ) );
+        }
+        bench( std::string( "quote " ) + magnitude_names[m], [&]( uint64_t i ) { return bancor::quote( inputs.amount_in[i & mask], inputs.reserve_in[i & mask], 500000, inputs.reserve_out[i & mask], 500000 ); } );
+
+        for ( uint8_t w = 0; w < 3; ++w ) {
+            const uint64_t w_in = weights[w][0], w_out = weights[w][1];
+            for ( uint64_t i = 0; i < INPUTS; ++i ) {
+                inputs.amount_out[i] = std::max<uint64_t>( 1, bancor::get_amount_out( inputs.amount_in[i], inputs.reserve_in[i], w_in, inputs.reserve_out[i], w_out, 2000 ) );
+            }
+            const std::string suffix = std::string( " " ) + magnitude_names[m] + " " + weight_names[w];
+            bench( "get_amount_out" + suffix, [&]( uint64_t i ) { return bancor::get_amount_out( inputs.amount_in[i & mask], inputs.reserve_in[i & mask], w_in, inputs.reserve_out[i & mask], w_out, 2000 ); } );
+            bench( "get_amount_in" + suffix, [&]( uint64_t i ) { return bancor::get_amount_in( inputs.amount_out[i & mask], inputs.reserve_in[i & mask], w_in, inputs.reserve_out[i & mask], w_out, 2000 ); } );
+            bench( "get_price" + suffix, [&]( uint64_t i ) { return bancor::get_price( inputs.amount_in[i & mask], inputs.reserve_in[i & mask], w_in, inputs.reserve_out[i & mask], w_out, 2000 ).price_impact; } );
+            bench( "get_amount_out_double" + suffix, [&]( uint64_t i ) { return bancor::get_amount_out_double( inputs.amount_in[i & mask], inputs.reserve_in[i & mask], w_in, inputs.reserve_out[i & mask], w_out, 2000 ); } );
+
+            // screening: pool constants computed once, reused for every amount
+            std::vector<bancor::fast::pool> pools;
+            for ( uint64_t i = 0; i < INPUTS; ++i ) pools.push_back( bancor::hop{ inputs.reserve_in[i], w_in, inputs.reserve_out[i], w_out, 2000 } );
+            bench( "fast::get_amount_out" + suffix, [&]( uint64_t i ) { return bancor::fast::get_amount_out_interval( inputs.amount_in[i & mask], inputs.reserve_in[i & mask], w_in, inputs.reserve_out[i & mask], w_out, 2000 ).lower; } );
+            bench( "fast::get_amount_out (pool)" + suffix, [&]( uint64_t i ) { return bancor::fast::get_amount_out( pools[i & mask], inputs.amount_in[i & mask] ); } );
+
+            // smart token conversions: reserve_in as supply, reserve_out as reserve balance, w_in as reserve weight
+            const std::string weight_suffix = std::string( " " ) + magnitude_names[m] + " " + std::to_string( w_in );
+            bench( "purchase_return" + weight_suffix, [&]( uint64_t i ) { return bancor::purchase_return( inputs.reserve_in[i & mask], inputs.reserve_out[i & mask], w_in, inputs.amount_in[i & mask], 2000 ); } );
+            bench( "sale_return" + weight_suffix, [&]( uint64_t i ) { return bancor::sale_return( inputs.reserve_in[i & mask], inputs.reserve_out[i & mask], w_in, inputs.amount_in[i & mask], 2000 ); } );
+            bench( "fund_cost" + weight_suffix, [&]( uint64_t i ) { return bancor::fund_cost( inputs.reserve_in[i & mask], inputs.reserve_out[i & mask], 2 * w_in, inputs.amount_in[i & mask] ); } );
+        }
+    }
+
+    // formula internals (equal weights: specialization vs general log/exp engine)
+    const uint64_t reserve_in = 45851931234;
+    bench( "formula::rational_ratio<1, 1>", [&]( uint64_t i ) { return static_cast<uint64_t>( bancor::formula::rational_ratio<1, 1>( i * 7919, reserve_in ) ); } );
+    bench( "formula::rational_ratio<4, 1>", [&]( uint64_t i ) { return static_cast<uint64_t>( bancor::formula::rational_ratio<4, 1>( i * 7919, reserve_in ) ); } );
+    bench( "formula::rational_ratio<1, 2>", [&]( uint64_t i ) { return static_cast<uint64_t>( bancor::formula::rational_ratio<1, 2>( i * 7919, reserve_in ) ); } );
+    bench( "formula (log/exp) 1/1", [&]( uint64_t i ) { return static_cast<uint64_t>( bancor::formula::optimal_exp( bancor::formula::general_log( static_cast<safemath::uint128_t>(reserve_in) + i * 7919, reserve_in ) ) ); } );
+
+    // converter readers (local chain seeded from __tests__/fixtures)
+    bancor::load_fixtures();
+    bench_reads( "multi::get_reserves", [&]( uint64_t ) { return bancor::multi::get_reserves( {"EOSBNT"} ).size(); } );
+    bench_reads( "multi::get_fee", [&]( uint64_t ) { return bancor::multi::get_fee( {"EOSBNT"} ); } );
+    bench_reads( "multi::load", [&]( uint64_t ) { return bancor::multi::load( {"EOSBNT"} ).fee; } );
+    bench_reads( "legacy::get_reserves", [&]( uint64_t ) { return bancor::legacy::get_reserves( "bnt2eoscnvrt"_n ).size(); } );
+    bench_reads( "legacy::get_fee", [&]( uint64_t ) { return bancor::legacy::get_fee( "bnt2eoscnvrt"_n ); } );
+    bench_reads( "legacy::load", [&]( uint64_t ) { return bancor::legacy::load( "bnt2eoscnvrt"_n ).fee; } );
+
+    // N-reserve converter: every output quoted from one input (8 reserves, uneven weights)
+    bancor::multi::snapshot basket;
+    basket.fee = 2000;
+    basket.size = bancor::pool::MAX_RESERVES;
+    const char* basket_codes[] = { "EOS", "BNT", "USDT", "USDC", "DAI", "PBTC", "PETH", "VIGOR" };
+    for ( uint8_t i = 0; i < basket.size; ++i ) {
+        basket.symbols[i] = symbol_code( basket_codes[i] );
+        basket.reserves[i] = bancor::multi::reserve{ "tokens"_n, static_cast<uint64_t>( 100000 + 10000 * i ), asset( static_cast<int64_t>( around( state, 100000000000 ) ), symbol( basket.symbols[i], 4 ) ) };
+    }
+    const bancor::pool basket_pool = bancor::get_pool( basket );
+    std::vector<uint64_t> basket_amounts( INPUTS );
+    for ( uint64_t& amount : basket_amounts ) amount = around( state, 100000000 );
+    uint64_t basket_out[bancor::pool::MAX_RESERVES];
+    bench( "get_amounts_out (pool, 8 reserves)", [&]( uint64_t i ) {
+        bancor::get_amounts_out( basket_pool, i & 7, basket_amounts[i & mask], basket_out );
+        return basket_out[(i + 1) & 7];
+    } );
+    bench( "get_amount_out (pool, 8 reserves, pairwise)", [&]( uint64_t i ) {
+        uint64_t total = 0;
+        for ( uint8_t out = 0; out < basket_pool.size; ++out ) {
+            if ( out != (i & 7) ) total += bancor::get_amount_out( basket_pool, i & 7, out, basket_amounts[i & mask] );
+        }
+        return total;
+    } );
+    bench( "multi::get_amount_out (8 reserves, pairwise)", [&]( uint64_t i ) {
+        uint64_t total = 0;
+        for ( uint8_t out = 0; out < basket.size; ++out ) {
+            if ( out != (i & 7) ) total += bancor::multi::get_amount_out( basket, basket.symbols[i & 7], basket.symbols[out], basket_amounts[i & mask] );
+        }
+        return total;
+    } );
+
+    // router & arbitrage: 256 tokens paired with BNT (every 4th also with USDT), consistent prices within +-0.1%
+    const bancor::token bnt = { "bntbntbntbnt"_n, {"BNT"} };
+    const bancor::token usdt = { "tethertether"_n, {"USDT"} };
+    std::vector<bancor::token> tokens;
+    std::vector<bancor::multi::snapshot> converters;
+    for ( uint64_t i = 0; i < 256; ++i ) {
+        const std::string code = std::string( "T" ) + static_cast<char>('A' + i / 26 % 26) + static_cast<char>('A' + i % 26);
+        const uint64_t depth = around( state, 100000000000 );
+        const uint64_t price = around( state, 1000 );
+        tokens.push_back( bancor::token{ "tokens"_n, symbol_code( code ) } );
+        for ( const bancor::token& base : { bnt, usdt } ) {
+            if ( base == usdt && i % 4 ) continue;
+            // 1 BNT = 2 USDT
+            const uint64_t base_balance = depth / 1000 * price * (base == usdt ? 2 : 1) / 1000 * (999000 + next_random( state ) % 2000);
+            bancor::multi::snapshot converter;
+            converter.currency = symbol( code + base.code.to_string().substr( 0, 7 - code.size() ), 4 );
+            converter.fee = 2000;
+            converter.size = 2;
+            converter.symbols[0] = tokens.back().code;
+            converter.symbols[1] = base.code;
+            converter.reserves[0] = bancor::multi::reserve{ "tokens"_n, 500000, asset( static_cast<int64_t>( depth ), symbol( code, 4 ) ) };
+            converter.reserves[1] = bancor::multi::reserve{ base.contract, 500000, asset( static_cast<int64_t>( base_balance ), symbol( base.code, 4 ) ) };
+            converters.push_back( converter );
+        }
+    }
+
+    bancor::graph graph;
+    for ( const bancor::multi::snapshot& converter : converters ) graph.set_multi( converter );
+    bench( "get_routes (256 tokens, k=3, 3 hops)", [&]( uint64_t i ) { return bancor::get_routes( graph, tokens[i % 256], tokens[(i * 7 + 1) % 256], 100000000 )[0].amount_out; }, SAMPLES / 10 );
+    bench( "get_routes (256 tokens => USDT)", [&]( uint64_t i ) { return bancor::get_routes( graph, tokens[i % 256], usdt, 100000000 )[0].amount_out; }, SAMPLES / 10 );
+    bench( "graph::set_multi (update one converter)", [&]( uint64_t i ) { return graph.set_multi( converters[i % converters.size()] ); } );
+
+    // split order across parallel converters of the same pair (prices within +-0.1%)
+    std::vector<bancor::hop> parallel;
+    for ( uint64_t i = 0; i < 8; ++i ) {
+        const uint64_t depth = around( state, 100000000000 );
+        parallel.push_back( bancor::hop{ depth, 500000, depth / 1000000 * (999000 + next_random( state ) % 2000), 500000, 2000 } );
+    }
+    const std::vector<bancor::hop> pair( parallel.begin(), parallel.begin() + 2 );
+    bench( "get_split (2 converters)", [&]( uint64_t i ) { return bancor::get_split( pair, 10000000000 + i % 1024 ).amount_out; }, SAMPLES / 10 );
+    bench( "get_split (8 converters)", [&]( uint64_t i ) { return bancor::get_split( parallel, 10000000000 + i % 1024 ).amount_out; }, SAMPLES / 10 );
+
+    // reserve updates within fees (no cycle) and a 2% move (one cycle, suspended until the next update)
+    bancor::arbitrage engine;
+    for ( const bancor::multi::snapshot& converter : converters ) engine.set_multi( converter );
+    bench( "arbitrage::set_multi (no cycle)", [&]( uint64_t i ) {
+        bancor::multi::snapshot converter = converters[i % converters.size()];
+        converter.reserves[1].balance.amount += converter.reserves[1].balance.amount / 2000;
+        return engine.set_multi( converter ).size();
+    } );
+    bench( "arbitrage::set_multi (2% move, cycle)", [&]( uint64_t i ) {
+        bancor::multi::snapshot converter = converters[i % converters.size()];
+        converter.reserves[1].balance.amount += converter.reserves[1].balance.amount / 50 * (i % 2);
+        return engine.set_multi( converter ).size();
+    }, SAMPLES / 10 );
+
+    // quote server: same 256-token book, pair quotes in process, over a socket pair and under load
+    bancor::server::store store;
+    store.update( [&]( bancor::graph& book ) { for ( const bancor::multi::snapshot& converter : converters ) book.set_multi( converter ); } );
+    std::vector<bancor::server::request> requests( INPUTS );
+    for ( uint64_t i = 0; i < INPUTS; ++i ) {
+        const bancor::multi::snapshot& converter = converters[i % converters.size()];
+        requests[i].id = i;
+        requests[i].code = bancor::multi::code.value;
+        requests[i].currency = converter.currency.code().raw();
+        requests[i].symbol_in = converter.symbols[i % 2].raw();
+        requests[i].symbol_out = converter.symbols[1 - i % 2].raw();
+        requests[i].amount = around( state, 100000000 );
+    }
+    bench( "server::handle (pair)", [&]( uint64_t i ) { return bancor::server::handle( *store.read( 0 ), requests[i & mask] ).amount; } );
+    bench( "server::store::update (256 converters)", [&]( uint64_t i ) { return store.set_multi( converters[i % converters.size()] ); }, SAMPLES / 100 );
+
+    bancor::server::table table( 512 );
+    for ( const bancor::multi::snapshot& converter : converters ) table.set( converter );
+    std::vector<bancor::pool> pools( converters.size() );
+    for ( size_t i = 0; i < converters.size(); ++i ) pools[i] = bancor::get_pool( converters[i] );
+    bench( "server::table::get (256 converters)", [&]( uint64_t i ) { return table.get( converters[i % converters.size()].currency.code() ).balances[0]; } );
+    bench( "server::table::get + get_amount_out", [&]( uint64_t i ) {
+        const bancor::pool pool = table.get( symbol_code( requests[i & mask].currency ) );
+        return bancor::get_amount_out( pool, i % 2, 1 - i % 2, requests[i & mask].amount );
+    } );
+    bench( "server::table::set", [&]( uint64_t i ) { return table.set( converters[i % converters.size()].currency.code(), pools[i % pools.size()] ); } );
+
+    // table-delta ingestion: converter.v2 rows of the 256 converters, one balance moved per delta
+    std::vector<bancor::delta::row> deltas;
+    for ( uint64_t i = 0; i < 2 * converters.size(); ++i ) {
+        const bancor::multi::snapshot& converter = converters[i % converters.size()];
+        bancor::multi::converter_row row;
+        row.currency = converter.currency;
+        row.fee = converter.fee;
+        for ( const bancor::multi::reserve& reserve : converter ) {
+            row.reserve_weights[reserve.balance.symbol.code()] = reserve.weight;
+            row.reserve_balances[reserve.balance.symbol.code()] = extended_asset( reserve.balance, reserve.contract );
+        }
+        row.reserve_balances.begin()->second.quantity.amount += i / converters.size();
+        deltas.push_back( bancor::delta::make_row( bancor::multi::code, bancor::multi::code.value, "converter.v2"_n, row.primary_key(), row ) );
+    }
+    // converter.v2 row decode & reserve lookup: std::map row vs flat row
+    bench( "decode converter_row (2 reserves)", [&]( uint64_t i ) {
+        const bancor::delta::row& item = deltas[i % deltas.size()];
+        bancor::delta::reader ds{ item.value.data(), item.value.data() + item.value.size() };
+        bancor::multi::converter_row row;
+        bancor::delta::decode( ds, row );
+        return row.fee;
+    } );
+    bench( "decode flat_row (2 reserves)", [&]( uint64_t i ) {
+        const bancor::delta::row& item = deltas[i % deltas.size()];
+        bancor::delta::reader ds{ item.value.data(), item.value.data() + item.value.size() };
+        bancor::multi::flat_row row;
+        bancor::delta::decode( ds, row );
+        return row.snapshot.fee;
+    } );
+    std::vector<bancor::multi::converter_row> map_rows;
+    std::vector<bancor::multi::flat_row> flat_rows;
+    for ( const bancor::multi::snapshot& converter : converters ) {
+        bancor::multi::converter_row row;
+        for ( const bancor::multi::reserve& reserve : converter ) {
+            row.reserve_weights[reserve.balance.symbol.code()] = reserve.weight;
+            row.reserve_balances[reserve.balance.symbol.code()] = extended_asset( reserve.balance, reserve.contract );
+        }
+        map_rows.push_back( row );
+        flat_rows.push_back( bancor::multi::to_flat( row ) );
+    }
+    bench( "converter_row reserve lookup (weight & balance)", [&]( uint64_t i ) {
+        const bancor::multi::converter_row& row = map_rows[i % map_rows.size()];
+        const symbol_code reserve = converters[i % converters.size()].symbols[i & 1];
+        return row.reserve_weights.at( reserve ) + row.reserve_balances.at( reserve ).quantity.amount;
+    } );
+    bench( "flat_row reserve lookup (weight & balance)", [&]( uint64_t i ) {
+        const bancor::multi::reserve& item = flat_rows[i % flat_rows.size()].snapshot.get( converters[i % converters.size()].symbols[i & 1] );
+        return item.weight + item.balance.amount;
+    } );
+
+    bancor::delta::state ingest;
+    bancor::delta::dirty dirty;
+    bancor::graph live;
+    bench( "delta::state::apply (converter.v2 row)", [&]( uint64_t i ) {
+        dirty.clear();
+        ingest.apply( deltas[i % deltas.size()], dirty );
+        return dirty.changes.size();
+    } );
+    bench( "delta apply + graph (1 dirty converter)", [&]( uint64_t i ) {
+        dirty.clear();
+        ingest.apply( deltas[i % deltas.size()], dirty );
+        bancor::delta::apply( live, ingest, dirty );
+        return dirty.changes.size();
+    } );
+    bench( "graph reload (256 converters)", [&]( uint64_t ) {
+        for ( const auto& item : ingest.multi ) live.set_multi( item.second );
+        return live.converters.size();
+    }, SAMPLES / 100 );
+
+    // cold start: decoding the 256 converter.v2 rows vs mapping a binary snapshot of them
+    bench( "delta::state cold start (256 rows)", [&]( uint64_t ) {
+        bancor::delta::state cold;
+        bancor::delta::dirty changes;
+        for ( uint64_t i = 0; i < converters.size(); ++i ) cold.apply( deltas[i], changes );
+        return cold.multi.size();
+    }, SAMPLES / 100 );
+    const std::string image_path = "/tmp/sx.bancor.bench." + std::to_string( ::getpid() ) + ".bin";
+    bancor::image::writer snapshot;
+    for ( const auto& item : ingest.multi ) snapshot.add( item.second );
+    snapshot.write( image_path );
+    bench( "image::file open + first quote (256 converters)", [&]( uint64_t i ) {
+        const bancor::image::file mapped( image_path );
+        const bancor::multi::snapshot& converter = converters[i % converters.size()];
+        return bancor::image::get_amount_out( *mapped.find_multi( converter.currency.code() ), converter.symbols[0], converter.symbols[1], 100000000 );
+    }, SAMPLES / 10 );
+    {
+        const bancor::image::file mapped( image_path );
+        bench( "image::find_multi + get_amount_out", [&]( uint64_t i ) {
+            const bancor::multi::snapshot& converter = converters[i % converters.size()];
+            return bancor::image::get_amount_out( *mapped.find_multi( converter.currency.code() ), converter.symbols[0], converter.symbols[1], 100000000 );
+        } );
+        bench( "image::load graph (256 converters)", [&]( uint64_t ) {
+            bancor::graph mapped_graph;
+            bancor::image::load( mapped_graph, mapped );
+            return mapped_graph.converters.size();
+        }, SAMPLES / 100 );
+    }
+    std::remove( image_path.c_str() );
+
+    int fds[2];
+    eosio::check( ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) == 0, "bench: cannot create socket pair" );
+    std::thread worker( [&] { bancor::server::serve( store, 1, fds[1], fds[1] ); } );
+    bench( "server round trip (socket pair)", [&]( uint64_t i ) { return bancor::server::query( fds[0], requests[i & mask] ).amount; }, SAMPLES / 10 );
+    ::shutdown( fds[0], SHUT_WR );
+    worker.join();
+    ::close( fds[0] );
+    ::close( fds[1] );
+
+    // `workers` workers, `connections` clients (one connection each) & a feed thread publishing one converter every
+    // 100 µs; percentiles of single request latencies (p99 tracks the accept thread balancing connections)
+    const std::string path = "/tmp/sx.bancor.bench." + std::to_string( ::getpid() ) + ".sock";
+    const auto bench_server = [&]( const uint32_t workers, const uint32_t connections ) {
+        bancor::server::listener server( store, path.c_str(), workers );
+        server.start();
+        std::atomic<bool> running{ true };
+        std::thread feed( [&] {
+            for ( uint64_t i = 0; running.load(); ++i ) {
+                store.set_multi( converters[i % converters.size()] );
+                std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+            }
+        });
+
+        const uint64_t count = SAMPLES * 40 / connections;
+        std::vector<std::vector<double>> latencies( connections, std::vector<double>( count ) );
+        std::vector<std::thread> clients;
+        const auto start = std::chrono::steady_clock::now();
+        for ( uint64_t c = 0; c < connections; ++c ) {
+            clients.emplace_back( [&, c] {
+                const int fd = bancor::server::connect( path.c_str() );
+                eosio::check( fd >= 0, "bench: cannot connect" );
+                for ( uint64_t i = 0; i < count; ++i ) {
+                    const auto request_start = std::chrono::steady_clock::now();
+                    sink = bancor::server::query( fd, requests[(i * connections + c) & mask] ).amount;
+                    latencies[c][i] = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - request_start ).count();
+                }
+                ::close( fd );
+            });
+        }
+        for ( std::thread& client : clients ) client.join();
+        const double total = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+        running = false;
+        feed.join();
+        server.stop();
+
+        std::vector<double> sorted;
+        for ( const std::vector<double>& item : latencies ) sorted.insert( sorted.end(), item.begin(), item.end() );
+        std::sort( sorted.begin(), sorted.end() );
+        const double ns = total / sorted.size();
+        const std::string name = "server (" + std::to_string( workers ) + " workers, " + std::to_string( connections ) + " clients, live updates)";
+        results.push_back( result{ name, ns, 1e9 / ns, percentile( sorted, 0.50 ), percentile( sorted, 0.90 ), percentile( sorted, 0.99 ), -1 } );
+        const result& res = results.back();
+        printf( "%-48s %10.1f ns/op %12.0f ops/s   p50 %8.1f  p90 %8.1f  p99 %8.1f\n", res.name.c_str(), res.ns_per_op, res.ops_per_sec, res.p50, res.p90, res.p99 );
+    };
+    bench_server( 4, 4 );
+    bench_server( 8, 16 );
+
+    if ( argc > 1 ) write_json( argv[1], backend );
+    return 0;
+}
@@ -0,0 +1,605 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "bancor.graph.hpp"
+
+/**
+ * Streaming table-delta ingestion (off-chain)
+ *
+ * Stand-in of a state-history feed: length-prefixed `contract_row` frames (present flag, code, scope, table,
+ * primary key, payer & the row in EOSIO ABI binary) read from a file or a pipe. `converter.v2`, legacy
+ * `settings` / `reserves` and token `accounts` rows are decoded into the contract row layouts, the affected
+ * converters rebuilt as flat snapshots and compared reserve by reserve, so downstream caches & graphs only
+ * receive the reserves that actually changed.
+ */
+namespace bancor {
+namespace delta {
+
+    /**
+     * ## STRUCT `reader`
+     *
+     * EOSIO ABI binary decoder over a byte range (little endian integers, varuint32 lengths)
+     */
+    struct reader {
+        const char*     pos;
+        const char*     end;
+
+        void read_bytes( void* data, const size_t size )
+        {
+            eosio::check( static_cast<size_t>(end - pos) >= size, "sx.bancor::delta: truncated row");
+            std::memcpy( data, pos, size );
+            pos += size;
+        }
+
+        // eosio::datastream interface (`ds >> row` of the contract row types)
+        void read( char* data, const size_t size ) { read_bytes( data, size ); }
+        void skip( const size_t size )
+        {
+            eosio::check( static_cast<size_t>(end - pos) >= size, "sx.bancor::delta: truncated row");
+            pos += size;
+        }
+
+        uint32_t read_varuint32()
+        {
+            uint32_t res = 0;
+            for ( uint8_t shift = 0; ; shift += 7 ) {
+                eosio::check( shift < 35, "sx.bancor::delta: invalid varuint32");
+                uint8_t byte;
+                read_bytes( &byte, 1 );
+                res |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if ( !(byte & 0x80) ) return res;
+            }
+        }
+    };
+
+    /**
+     * ## STRUCT `writer`
+     *
+     * EOSIO ABI binary encoder (used to produce frames & snapshots)
+     */
+    struct writer {
+        vector<char>    data;
+
+        void write_bytes( const void* bytes, const size_t size )
+        {
+            const char* ptr = static_cast<const char*>( bytes );
+            data.insert( data.end(), ptr, ptr + size );
+        }
+
+        void write_varuint32( uint32_t value )
+        {
+            do {
+                uint8_t byte = value & 0x7f;
+                value >>= 7;
+                if ( value ) byte |= 0x80;
+                write_bytes( &byte, 1 );
+            } while ( value );
+        }
+    };
+
+    // scalars & chain types
+    inline void decode( reader& ds, uint64_t& res ) { ds.read_bytes( &res, sizeof( res ) ); }
+    inline void decode( reader& ds, int64_t& res ) { ds.read_bytes( &res, sizeof( res ) ); }
+    inline void decode( reader& ds, bool& res ) { uint8_t byte; ds.read_bytes( &byte, 1 ); res = byte != 0; }
+    inline void decode( reader& ds, name& res ) { decode( ds, res.value ); }
+    inline void decode( reader& ds, symbol_code& res ) { uint64_t raw; decode( ds, raw ); res = symbol_code( raw ); }
+    inline void decode( reader& ds, symbol& res ) { uint64_t raw; decode( ds, raw ); res = symbol( raw ); }
+    inline void decode( reader& ds, asset& res ) { decode( ds, res.amount ); decode( ds, res.symbol ); }
+    inline void decode( reader& ds, extended_asset& res ) { decode( ds, res.quantity ); decode( ds, res.contract ); }
+    inline void decode( reader& ds, string& res )
+    {
+        res.resize( ds.read_varuint32() );
+        if ( !res.empty() ) ds.read_bytes( &res[0], res.size() );
+    }
+
+    template <typename K, typename V>
+    void decode( reader& ds, map<K, V>& res )
+    {
+        res.clear();
+        for ( uint32_t size = ds.read_varuint32(); size > 0; --size ) {
+            K key;
+            V value;
+            decode( ds, key );
+            decode( ds, value );
+            res.emplace( key, value );
+        }
+    }
+
+    inline void encode( writer& ds, const uint64_t value ) { ds.write_bytes( &value, sizeof( value ) ); }
+    inline void encode( writer& ds, const int64_t value ) { ds.write_bytes( &value, sizeof( value ) ); }
+    inline void encode( writer& ds, const bool value ) { const uint8_t byte = value; ds.write_bytes( &byte, 1 ); }
+    inline void encode( writer& ds, const name value ) { encode( ds, value.value ); }
+    inline void encode( writer& ds, const symbol_code value ) { encode( ds, value.raw() ); }
+    inline void encode( writer& ds, const symbol value ) { encode( ds, value.raw() ); }
+    inline void encode( writer& ds, const asset& value ) { encode( ds, value.amount ); encode( ds, value.symbol ); }
+    inline void encode( writer& ds, const extended_asset& value ) { encode( ds, value.quantity ); encode( ds, value.contract ); }
+    inline void encode( writer& ds, const string& value )
+    {
+        ds.write_varuint32( value.size() );
+        ds.write_bytes( value.data(), value.size() );
+    }
+
+    template <typename K, typename V>
+    void encode( writer& ds, const map<K, V>& value )
+    {
+        ds.write_varuint32( value.size() );
+        for ( const auto& item : value ) {
+            encode( ds, item.first );
+            encode( ds, item.second );
+        }
+    }
+
+    // contract rows (field order of the ABI)
+    inline void decode( reader& ds, bancor::multi::converter_row& row )
+    {
+        decode( ds, row.currency );
+        decode( ds, row.owner );
+        decode( ds, row.fee );
+        decode( ds, row.reserve_weights );
+        decode( ds, row.reserve_balances );
+        decode( ds, row.protocol_features );
+        decode( ds, row.metadata_json );
+    }
+
+    // same bytes, no maps (optional maps skipped)
+    inline void decode( reader& ds, bancor::multi::flat_row& row ) { ds >> row; }
+
+    inline void encode( writer& ds, const bancor::multi::converter_row& row )
+    {
+        encode( ds, row.currency );
+        encode( ds, row.owner );
+        encode( ds, row.fee );
+        encode( ds, row.reserve_weights );
+        encode( ds, row.reserve_balances );
+        encode( ds, row.protocol_features );
+        encode( ds, row.metadata_json );
+    }
+
+    inline void decode( reader& ds, bancor::legacy::settings_row& row )
+    {
+        decode( ds, row.smart_contract );
+        decode( ds, row.smart_currency );
+        decode( ds, row.smart_enabled );
+        decode( ds, row.enabled );
+        decode( ds, row.network );
+        decode( ds, row.require_balance );
+        decode( ds, row.max_fee );
+        decode( ds, row.fee );
+    }
+
+    inline void encode( writer& ds, const bancor::legacy::settings_row& row )
+    {
+        encode( ds, row.smart_contract );
+        encode( ds, row.smart_currency );
+        encode( ds, row.smart_enabled );
+        encode( ds, row.enabled );
+        encode( ds, row.network );
+        encode( ds, row.require_balance );
+        encode( ds, row.max_fee );
+        encode( ds, row.fee );
+    }
+
+    inline void decode( reader& ds, bancor::legacy::reserves_row& row )
+    {
+        decode( ds, row.contract );
+        decode( ds, row.currency );
+        decode( ds, row.ratio );
+        decode( ds, row.p_enabled );
+    }
+
+    inline void encode( writer& ds, const bancor::legacy::reserves_row& row )
+    {
+        encode( ds, row.contract );
+        encode( ds, row.currency );
+        encode( ds, row.ratio );
+        encode( ds, row.p_enabled );
+    }
+
+    inline void decode( reader& ds, bancor::legacy::accounts_row& row ) { decode( ds, row.balance ); }
+    inline void encode( writer& ds, const bancor::legacy::accounts_row& row ) { encode( ds, row.balance ); }
+
+    /**
+     * ## STRUCT `row`
+     *
+     * One table-row delta (`contract_row` of a state-history `table_delta`)
+     *
+     * ### params
+     *
+     * - `{bool} present` - false when the row was erased
+     * - `{name} code` - contract account
+     * - `{uint64_t} scope` - table scope
+     * - `{name} table` - table name
+     * - `{uint64_t} primary_key` - row primary key
+     * - `{name} payer` - RAM payer
+     * - `{string} value` - row in EOSIO ABI binary (empty when erased)
+     *
+     * Frame on the stream: `uint32_t size` (little endian) followed by the fields above, `value` as bytes (varuint32 + data).
+     */
+    struct row {
+        bool            present = true;
+        name            code;
+        uint64_t        scope = 0;
+        name            table;
+        uint64_t        primary_key = 0;
+        name            payer;
+        string          value;
+    };
+
+    // row of a table delta, `value` encoded from a contract row
+    template <typename T>
+    bancor::delta::row make_row( const name code, const uint64_t scope, const name table, const uint64_t primary_key, const T& value )
+    {
+        writer ds;
+        encode( ds, value );
+        return bancor::delta::row{ true, code, scope, table, primary_key, code, string( ds.data.begin(), ds.data.end() ) };
+    }
+
+    // length-prefixed frame of one row delta
+    inline void encode_frame( writer& ds, const bancor::delta::row& item )
+    {
+        writer body;
+        encode( body, item.present );
+        encode( body, item.code );
+        encode( body, item.scope );
+        encode( body, item.table );
+        encode( body, item.primary_key );
+        encode( body, item.payer );
+        encode( body, item.value );
+
+        const uint32_t size = body.data.size();
+        ds.write_bytes( &size, sizeof( size ) );
+        ds.write_bytes( body.data.data(), body.data.size() );
+    }
+
+    inline void decode_frame( reader& ds, bancor::delta::row& item )
+    {
+        decode( ds, item.present );
+        decode( ds, item.code );
+        decode( ds, item.scope );
+        decode( ds, item.table );
+        decode( ds, item.primary_key );
+        decode( ds, item.payer );
+        decode( ds, item.value );
+        eosio::check( ds.pos == ds.end, "sx.bancor::delta: trailing frame bytes");
+    }
+
+    /**
+     * ## STRUCT `stream`
+     *
+     * Buffered frame reader over a file or pipe descriptor
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::delta::stream feed( fd );
+     * bancor::delta::row item;
+     * while ( feed.next( item ) ) { ... }
+     * ```
+     */
+    struct stream {
+        static constexpr uint32_t MAX_FRAME = 1 << 20;
+
+        explicit stream( const int fd ) : _fd( fd ) {}
+
+        // next frame, false at end of stream
+        bool next( bancor::delta::row& item )
+        {
+            uint32_t size;
+            if ( !fill( sizeof( size ) ) ) return false;
+            std::memcpy( &size, _buffer.data() + _pos, sizeof( size ) );
+            eosio::check( size <= MAX_FRAME, "sx.bancor::delta: frame too large");
+            eosio::check( fill( sizeof( size ) + size ), "sx.bancor::delta: truncated frame");
+
+            reader ds{ _buffer.data() + _pos + sizeof( size ), _buffer.data() + _pos + sizeof( size ) + size };
+            decode_frame( ds, item );
+            _pos += sizeof( size ) + size;
+            return true;
+        }
+
+    private:
+        // at least `size` unread bytes buffered, false at end of stream
+        bool fill( const size_t size )
+        {
+            if ( _buffer.size() - _pos >= size ) return true;
+            _buffer.erase( _buffer.begin(), _buffer.begin() + _pos );
+            _pos = 0;
+            while ( _buffer.size() < size ) {
+                char chunk[65536];
+                const ssize_t n = ::read( _fd, chunk, sizeof( chunk ) );
+                if ( n < 0 && errno == EINTR ) continue;
+                if ( n <= 0 ) return false;
+                _buffer.insert( _buffer.end(), chunk, chunk + n );
+            }
+            return true;
+        }
+
+        int             _fd;
+        vector<char>    _buffer;
+        size_t          _pos = 0;
+    };
+
+    /**
+     * ## STRUCT `change`
+     *
+     * Dirty entry of one converter
+     *
+     * ### params
+     *
+     * - `{name} type` - `bancor::multi::id` or `bancor::legacy::id`
+     * - `{name} code` - converter contract account
+     * - `{symbol_code} currency` - multi converter currency (empty for legacy converters)
+     * - `{uint8_t} reserves` - bit `i` set when reserve `i` (snapshot order) changed balance, weight or contract
+     * - `{bool} fee` - fee changed
+     * - `{bool} added` - converter is new (every reserve flagged)
+     * - `{bool} removed` - converter was erased (every previous reserve flagged)
+     */
+    struct change {
+        name            type;
+        name            code;
+        symbol_code     currency;
+        uint8_t         reserves = 0;
+        bool            fee = false;
+        bool            added = false;
+        bool            removed = false;
+    };
+
+    /**
+     * ## STRUCT `dirty`
+     *
+     * Changes of a batch, one entry per converter (flags merged)
+     */
+    struct dirty {
+        vector<bancor::delta::change>   changes;
+
+        void add( const bancor::delta::change& item )
+        {
+            const std::pair<uint64_t, uint64_t> key = { item.code.value, item.currency.raw() };
+            const auto itr = _index.find( key );
+            if ( itr == _index.end() ) {
+                _index.emplace( key, changes.size() );
+                changes.push_back( item );
+                return;
+            }
+            bancor::delta::change& current = changes[itr->second];
+            current.reserves |= item.reserves;
+            current.fee |= item.fee;
+            current.added = (current.added || item.added) && !item.removed;
+            current.removed = item.removed;
+        }
+
+        bool empty() const { return changes.empty(); }
+
+        void clear()
+        {
+            changes.clear();
+            _index.clear();
+        }
+
+    private:
+        std::map<std::pair<uint64_t, uint64_t>, size_t>     _index;     // (code, currency)
+    };
+
+    /**
+     * ## STRUCT `state`
+     *
+     * Converter state maintained from row deltas
+     *
+     * Multi converters of `multi_code` are tracked automatically; legacy converters are tracked once registered
+     * with `track_legacy` (their `settings`, `reserves` and the `accounts` rows scoped to the converter account).
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::delta::state state;
+     * state.track_legacy( "bnt2eoscnvrt"_n );
+     *
+     * bancor::delta::stream feed( fd );
+     * bancor::delta::dirty dirty;
+     * state.consume( feed, dirty );
+     * bancor::delta::apply( graph, state, dirty );
+     * ```
+     */
+    struct state {
+        struct legacy_converter {
+            bool                                                has_settings = false;
+            bancor::legacy::settings_row                        settings;
+            map<symbol_code, bancor::legacy::reserves_row>      reserves;
+            map<std::pair<uint64_t, uint64_t>, asset>           balances;   // (token contract, symbol code)
+            bancor::legacy::snapshot                            snapshot;
+            bool                                                loaded = false;
+        };
+
+        name                                                multi_code = bancor::multi::code;
+        map<symbol_code, bancor::multi::snapshot>           multi;
+        map<name, legacy_converter>                         legacy;
+
+        void track_legacy( const name code )
+        {
+            legacy.emplace( code, legacy_converter{} );
+        }
+
+        // apply one row delta, false when the row is not tracked
+        bool apply( const bancor::delta::row& item, bancor::delta::dirty& dirty )
+        {
+            if ( item.code == multi_code && item.table == "converter.v2"_n ) {
+                apply_multi( item, dirty );
+                return true;
+            }
+            if ( item.table == "settings"_n || item.table == "reserves"_n ) {
+                const auto itr = legacy.find( item.code );
+                if ( itr == legacy.end() ) return false;
+                legacy_converter& conv = itr->second;
+                if ( item.table == "settings"_n ) {
+                    conv.has_settings = item.present;
+                    if ( item.present ) decode_value( item, conv.settings );
+                } else if ( item.present ) {
+                    decode_value( item, conv.reserves[symbol_code( item.primary_key )] );
+                } else {
+                    conv.reserves.erase( symbol_code( item.primary_key ) );
+                }
+                refresh_legacy( item.code, conv, dirty );
+                return true;
+            }
+            if ( item.table == "accounts"_n ) {
+                const auto itr = legacy.find( name( item.scope ) );
+                if ( itr == legacy.end() ) return false;
+                legacy_converter& conv = itr->second;
+                const std::pair<uint64_t, uint64_t> key = { item.code.value, item.primary_key };
+                if ( item.present ) {
+                    bancor::legacy::accounts_row balance;
+                    decode_value( item, balance );
+                    conv.balances[key] = balance.balance;
+                } else {
+                    conv.balances.erase( key );
+                }
+                refresh_legacy( itr->first, conv, dirty );
+                return true;
+            }
+            return false;
+        }
+
+        // apply every frame of a stream (or `max_rows`), returns the number of rows read
+        uint64_t consume( bancor::delta::stream& feed, bancor::delta::dirty& dirty, const uint64_t max_rows = UINT64_MAX )
+        {
+            uint64_t count = 0;
+            bancor::delta::row item;
+            while ( count < max_rows && feed.next( item ) ) {
+                apply( item, dirty );
+                ++count;
+            }
+            return count;
+        }
+
+    private:
+        template <typename T>
+        static void decode_value( const bancor::delta::row& item, T& res )
+        {
+            reader ds{ item.value.data(), item.value.data() + item.value.size() };
+            decode( ds, res );
+        }
+
+        // bit of every reserve that differs (all reserves when the layout changed)
+        template <typename S>
+        static uint8_t compare( const S& before, const S& after )
+        {
+            if ( before.size != after.size ) return 0xff;
+            uint8_t res = 0;
+            for ( uint8_t i = 0; i < after.size; ++i ) {
+                const auto& a = before.reserves[i];
+                const auto& b = after.reserves[i];
+                if ( before.symbols[i] != after.symbols[i] || a.contract != b.contract || a.weight != b.weight || a.balance != b.balance ) res |= 1 << i;
+            }
+            return res;
+        }
+
+        void apply_multi( const bancor::delta::row& item, bancor::delta::dirty& dirty )
+        {
+            const symbol_code currency( item.primary_key );
+            const auto itr = multi.find( currency );
+            bancor::delta::change res{ bancor::multi::id, item.code, currency };
+
+            if ( !item.present ) {
+                if ( itr == multi.end() ) return;
+                res.reserves = (1 << itr->second.size) - 1;
+                res.removed = true;
+                multi.erase( itr );
+                dirty.add( res );
+                return;
+            }
+
+            bancor::multi::flat_row row;
+            decode_value( item, row );
+            const bancor::multi::snapshot snapshot = bancor::multi::load( row );
+            if ( itr == multi.end() ) {
+                res.reserves = (1 << snapshot.size) - 1;
+                res.fee = true;
+                res.added = true;
+                multi.emplace( currency, snapshot );
+            } else {
+                res.reserves = compare( itr->second, snapshot );
+                res.fee = itr->second.fee != snapshot.fee;
+                itr->second = snapshot;
+            }
+            if ( res.reserves || res.fee || res.added ) dirty.add( res );
+        }
+
+        // rebuild the snapshot of a legacy converter from its rows (complete once settings & every balance arrived)
+        void refresh_legacy( const name code, legacy_converter& conv, bancor::delta::dirty& dirty )
+        {
+            bancor::legacy::snapshot snapshot;
+            snapshot.code = code;
+            bool complete = conv.has_settings && !conv.reserves.empty() && conv.reserves.size() <= bancor::legacy::snapshot::MAX_RESERVES;
+            if ( complete ) {
+                snapshot.fee = conv.settings.fee;
+                for ( const auto& item : conv.reserves ) {
+                    const auto balance = conv.balances.find( { item.second.contract.value, item.first.raw() } );
+                    if ( balance == conv.balances.end() ) {
+                        complete = false;
+                        break;
+                    }
+                    snapshot.symbols[snapshot.size] = item.first;
+                    snapshot.reserves[snapshot.size] = bancor::legacy::reserve{ item.second.contract, item.second.ratio, balance->second };
+                    snapshot.size += 1;
+                }
+            }
+
+            bancor::delta::change res{ bancor::legacy::id, code, symbol_code{} };
+            if ( !complete ) {
+                if ( !conv.loaded ) return;
+                res.reserves = (1 << conv.snapshot.size) - 1;
+                res.removed = true;
+                conv.loaded = false;
+            } else if ( !conv.loaded ) {
+                res.reserves = (1 << snapshot.size) - 1;
+                res.fee = true;
+                res.added = true;
+                conv.loaded = true;
+            } else {
+                res.reserves = compare( conv.snapshot, snapshot );
+                res.fee = conv.snapshot.fee != snapshot.fee;
+            }
+            conv.snapshot = snapshot;
+            if ( res.reserves || res.fee || res.added || res.removed ) dirty.add( res );
+        }
+    };
+
+    /**
+     * ## STATIC `apply`
+     *
+     * Refresh the converters of a dirty set in a graph (edges of untouched converters are kept)
+     *
+     * Removed converters are kept with no reserve (no edge).
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::delta::apply( graph, state, dirty );
+     * dirty.clear();
+     * ```
+     */
+    static void apply( bancor::graph& graph, const bancor::delta::state& state, const bancor::delta::dirty& dirty )
+    {
+        for ( const bancor::delta::change& item : dirty.changes ) {
+            if ( item.type == bancor::multi::id ) {
+                const auto itr = state.multi.find( item.currency );
+                bancor::multi::snapshot empty;
+                empty.currency = symbol( item.currency, 0 );
+                graph.set_multi( itr == state.multi.end() ? empty : itr->second, item.code );
+            } else {
+                const auto itr = state.legacy.find( item.code );
+                if ( itr == state.legacy.end() ) continue;
+                bancor::legacy::snapshot empty;
+                empty.code = item.code;
+                graph.set_legacy( itr->second.loaded ? itr->second.snapshot : empty );
+            }
+        }
+    }
+}
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cstring>
+
+#include "bancor.hpp"
+#include "bancor.route.hpp"
+
+/**
+ * Fast conservative approximation of `get_amount_out` (route screening)
+ *
+ * Evaluates `reserve_out * (1 - e^-(weight_ratio * ln(1 + amount_in / reserve_in))) * (1 - fee)^2` in double precision
+ * with table driven `log1p` / `1 - e^-s` approximations (no libm calls), then widens the result by `MAX_RELATIVE_ERROR`.
+ *
+ * Error budget (relative, before widening):
+ *
+ * - input conversions, divisions & products: ~14 roundings of 2^-53
+ * - `log1p`: series truncated below 2^-38 (`u < 1/32`), below 2^-44 absolute for `ln(1 + u) >= 1/32.5` otherwise
+ * - `1 - e^-s`: series truncated below 2^-42 (`s < 1/32`), `e^-t` below 2^-44 amplified at most 32x otherwise
+ *
+ * which stays below 2^-36; `MAX_RELATIVE_ERROR = 2^-30` leaves a 64x margin, so `upper` is never below the true
+ * (real valued) output.
+ *
+ * `lower` is also never above the exact integer `bancor::get_amount_out`, which rounds down at every step: it is widened
+ * by `KERNEL_ULPS * (1 + weight_ratio)` ulps of `reserve_out` in Q.64 (the engine stays within ~8, measured with the
+ * accuracy harness over weight ratios up to 10^6) plus the final floor.
+ *
+ * Speed (`./bench.sh`): with a prebuilt `pool` the bound is ~3x faster than the exact path for general weights
+ * (~12 ns vs ~35 ns with the table-driven log/exp engine). Equal and rational weight ratios already have cheap exact
+ * kernels (`formula::rational_ratio`), so screening them is only ~1.1-1.5x faster; building the `pool` per call
+ * (`get_amount_out_interval` on raw reserves) roughly halves the gain.
+ */
+namespace bancor {
+namespace fast {
+
+    // guaranteed relative error bound of `approximate`
+    static constexpr double MAX_RELATIVE_ERROR = 0x1p-30;
+
+    // error bound of the integer kernel, in Q.64 ulps of `reserve_out` per unit of `1 + weight_ratio`
+    static constexpr double KERNEL_ULPS = 16;
+
+    static constexpr double LN2 = 0.6931471805599453;
+
+    /**
+     * ## STRUCT `interval`
+     *
+     * ### params
+     *
+     * - `{uint64_t} lower` - guaranteed lower bound of the output (never above `bancor::get_amount_out`)
+     * - `{uint64_t} upper` - guaranteed upper bound of the output (rounded up)
+     */
+    struct interval {
+        uint64_t    lower;
+        uint64_t    upper;
+    };
+
+    // 1 / c rounded to double, c = 1 + (j + 1/2) / 64, j = 0..63
+    static constexpr double LOG_INVERSE[64] = {
+        0.9922480620155039, 0.9770992366412213, 0.9624060150375939, 0.9481481481481482,
+        0.9343065693430657, 0.920863309352518, 0.9078014184397163, 0.8951048951048951,
+        0.8827586206896552, 0.8707482993197279, 0.8590604026845637, 0.847682119205298,
+        0.8366013071895425, 0.8258064516129032, 0.8152866242038217, 0.8050314465408805,
+        0.7950310559006211, 0.7852760736196319, 0.7757575757575758, 0.7664670658682635,
+        0.757396449704142, 0.7485380116959064, 0.7398843930635838, 0.7314285714285714,
+        0.7231638418079096, 0.7150837988826816, 0.7071823204419889, 0.6994535519125683,
+        0.6918918918918919, 0.6844919786096256, 0.6772486772486772, 0.6701570680628273,
+        0.6632124352331606, 0.6564102564102564, 0.649746192893401, 0.6432160804020101,
+        0.6368159203980099, 0.6305418719211823, 0.624390243902439, 0.6183574879227053,
+        0.6124401913875598, 0.6066350710900474, 0.6009389671361502, 0.5953488372093023,
+        0.5898617511520737, 0.5844748858447488, 0.579185520361991, 0.5739910313901345,
+        0.5688888888888889, 0.5638766519823789, 0.5589519650655022, 0.5541125541125541,
+        0.5493562231759657, 0.5446808510638298, 0.540084388185654, 0.5355648535564853,
+        0.5311203319502075, 0.5267489711934157, 0.5224489795918368, 0.5182186234817814,
+        0.5140562248995983, 0.5099601593625498, 0.5059288537549407, 0.5019607843137255,
+    };
+
+    // -ln(LOG_INVERSE[j]) (~ ln(c)), j = 0..63
+    static constexpr double LOG_CENTER[64] = {
+        0.007782140442054963, 0.023167059281534418, 0.03831886430213666, 0.05324451451881224,
+        0.06795066190850778, 0.08244366921107454, 0.09672962645855114, 0.11081436634029011,
+        0.12470347850095725, 0.1384023228591192, 0.151916042025842, 0.16524957289530717,
+        0.17840765747281825, 0.19139485299962947, 0.20421554142869083, 0.2168739383006143,
+        0.2293741010648459, 0.24171993688714513, 0.25391520998096345, 0.2659635484971379,
+        0.2778684510034563, 0.2896332925830427, 0.30126133057816185, 0.3127557100038969,
+        0.324119468654212, 0.3353555419211378, 0.3464667673462086, 0.3574558889218038,
+        0.36832556115870757, 0.3790783529349695, 0.38971675114002524, 0.40024316412701266,
+        0.4106599249852683, 0.42096929464412963, 0.43117346481837143, 0.4412745608048752,
+        0.4512746441394586, 0.46117571512217015, 0.470979715218791, 0.48068852934575196,
+        0.4903039880451939, 0.49982786955644926, 0.5092619017898079, 0.5186077642080457,
+        0.5278670896208424, 0.5370414658968837, 0.5461324375981356, 0.5551415075405016,
+        0.564070138284803, 0.5729197535617854, 0.5816917396346225, 0.5903874466021763,
+        0.5990081896460834, 0.6075552502245418, 0.616029877215514, 0.6244332880118936,
+        0.6327666695710378, 0.6410311794209312, 0.6492279466251097, 0.65735807270836,
+        0.6654226325450905, 0.6734226752121667, 0.6813592248079031, 0.689233281238809,
+    };
+
+    // 2^-(j/64), j = 0..63
+    static constexpr double EXP2_FRACTION[64] = {
+        1.0, 0.9892280131939755, 0.9785720620877001, 0.9680308967461472,
+        0.9576032806985737, 0.9472879907934828, 0.93708381705515, 0.9269895625416927,
+        0.9170040432046712, 0.9071260877501994, 0.8973545375015536, 0.8876882462632606,
+        0.8781260801866497, 0.8686669176368531, 0.859309649061239, 0.8500531768592617,
+        0.8408964152537145, 0.8318382901633682, 0.8228777390769825, 0.8140137109286739,
+        0.8052451659746271, 0.7965710756711335, 0.7879904225539432, 0.7795022001189185,
+        0.7711054127039704, 0.7627990753722692, 0.7545822137967114, 0.7464538641456324,
+        0.7384130729697497, 0.7304588970903235, 0.7225904034885233, 0.714806669195985,
+        0.7071067811865476, 0.6994898362691556, 0.691954940981916, 0.6845012114872953,
+        0.6771277734684463, 0.6698337620266515, 0.6626183215798707, 0.6554806057623822,
+        0.6484197773255048, 0.6414350080393891, 0.6345254785958666, 0.6276903785123455,
+        0.620928906036742, 0.614240268053435, 0.6076236799902345, 0.6010783657263515,
+        0.5946035575013605, 0.5881984958251406, 0.5818624293887887, 0.5755946149764913,
+        0.5693943173783458, 0.5632608093041209, 0.5571933712979462, 0.5511912916539204,
+        0.5452538663326288, 0.5393803988785599, 0.5335702003384118, 0.5278225891802786,
+        0.5221368912137069, 0.5165124395106142, 0.5109485743270583, 0.5054446430258502,
+    };
+
+    // IEEE-754 helpers (no libm calls)
+    static uint64_t to_bits( const double x )
+    {
+        uint64_t bits;
+        std::memcpy( &bits, &x, sizeof(bits) );
+        return bits;
+    }
+
+    static double from_bits( const uint64_t bits )
+    {
+        double x;
+        std::memcpy( &x, &bits, sizeof(x) );
+        return x;
+    }
+
+    /**
+     * ## STATIC `log1p`
+     *
+     * `ln(1 + u)` for `u >= 0` (relative error < 2^-37)
+     *
+     * Small `u` use the Taylor series; others are reduced to `2^e * c * (1 + d)` with `c` taken from the 64 entry table
+     * selected by the leading mantissa bits, so `|d| <= 1/128` and no division is needed.
+     */
+    static double log1p( const double u )
+    {
+        if ( u < 0.03125 ) {
+            // u - u^2/2 + ... + u^7/7 (split in powers of u^2 to shorten the dependency chain)
+            const double u2 = u * u;
+            return u + u2 * (u * (1.0 / 3) - 1.0 / 2) + (u2 * u2) * ((u * (1.0 / 5) - 1.0 / 4) + u2 * (u * (1.0 / 7) - 1.0 / 6));
+        }
+
+        // 1 + u = 2^e * m, m in [1, 2)
+        const uint64_t bits = to_bits( 1 + u );
+        const double e = static_cast<double>( static_cast<int64_t>(bits >> 52) - 1023 );
+        const uint64_t j = (bits >> 46) & 63;
+        const double m = from_bits( (bits & 0x000FFFFFFFFFFFFF) | 0x3FF0000000000000 );
+
+        // ln(1 + d) = d - d^2/2 + ... + d^5/5
+        const double d = m * LOG_INVERSE[j] - 1;
+        const double d2 = d * d;
+        const double series = d + d2 * (d * (1.0 / 3) - 1.0 / 2) + (d2 * d2) * (d * (1.0 / 5) - 1.0 / 4);
+        return e * LN2 + LOG_CENTER[j] + series;
+    }
+
+    /**
+     * ## STATIC `one_minus_exp`
+     *
+     * `1 - e^-s` for `s >= 0` (relative error < 2^-38)
+     *
+     * Small `s` use the Taylor series of `1 - e^-s`; others `2^-(n/64) * e^-t` with `|t| <= ln(2)/128` and a 64 entry table.
+     */
+    static double one_minus_exp( const double s )
+    {
+        if ( s < 0.03125 ) {
+            // s - s^2/2 + ... - s^6/720
+            const double s2 = s * s;
+            return s + s2 * (s * (1.0 / 6) - 1.0 / 2) + (s2 * s2) * ((s * (1.0 / 120) - 1.0 / 24) - s2 * (1.0 / 720));
+        }
+        if ( s >= 46 ) return 1;
+
+        // n = round(s * 64 / ln(2)) read from the mantissa of `x + 1.5 * 2^52`, t in [-ln(2)/128, ln(2)/128]
+        const double shifted = s * (64 / LN2) + 0x1.8p52;
+        const uint64_t n = to_bits( shifted ) & 0xFFFFFFFF;
+        const double t = s - (shifted - 0x1.8p52) * (LN2 / 64);
+
+        // e^-t = 1 - t + t^2/2 - t^3/6 + t^4/24
+        const double t2 = t * t;
+        const double series = (1 - t) + t2 * (1.0 / 2 - t * (1.0 / 6)) + (t2 * t2) * (1.0 / 24);
+
+        // 2^-k, k = n / 64 <= 66
+        const double scale = from_bits( static_cast<uint64_t>(1023 - (n >> 6)) << 52 );
+        return 1 - EXP2_FRACTION[n & 63] * series * scale;
+    }
+
+    /**
+     * ## STRUCT `pool`
+     *
+     * Per-converter constants of the fast kernels, computed once (validated like `bancor::route` hops)
+     *
+     * Screening reuses the same pools for every candidate amount, so `approximate` only multiplies by these.
+     *
+     * ### params
+     *
+     * - `{double} inverse_reserve_in` - `1 / reserve_in`
+     * - `{double} weight_ratio` - `reserve_weight_in / reserve_weight_out` (`0` for equal weights)
+     * - `{double} scale` - `reserve_out * (1 - fee)^2`
+     * - `{double} margin` - error bound of the integer kernel and its final floor (output units)
+     * - `{uint64_t} reserve_out` - reserve output (upper bound clamp)
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::fast::pool pool = bancor::hop{ 45851931234, 500000, 125682033533, 500000, 2000 };
+     * ```
+     */
+    struct pool {
+        double      inverse_reserve_in;
+        double      weight_ratio;
+        double      scale;
+        double      margin;
+        uint64_t    reserve_out;
+
+        pool( const hop& item )
+        {
+            // checks
+            eosio::check(item.reserve_in > 0 && item.reserve_out > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+            eosio::check(item.reserve_weight_in > 0 && item.reserve_weight_out > 0, "sx.bancor: INVALID_WEIGHT");
+            eosio::check(item.reserve_weight_in <= formula::MAX_WEIGHT && item.reserve_weight_out <= formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+            eosio::check(item.fee <= formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+            // constants
+            const uint64_t fee_factor = (formula::MAX_FEE - item.fee) * (formula::MAX_FEE - item.fee);
+            inverse_reserve_in = 1 / static_cast<double>(item.reserve_in);
+            weight_ratio = item.reserve_weight_in == item.reserve_weight_out ? 0 : static_cast<double>(item.reserve_weight_in) / item.reserve_weight_out;
+            scale = static_cast<double>(item.reserve_out) * (static_cast<double>(fee_factor) * 1e-12);
+            margin = static_cast<double>(item.reserve_out) * (1 + static_cast<double>(item.reserve_weight_in) / item.reserve_weight_out) * (KERNEL_ULPS * 0x1p-64) + 1;
+            reserve_out = item.reserve_out;
+        }
+    };
+
+    /**
+     * ## STATIC `approximate`
+     *
+     * Unchecked double estimate of `get_amount_out` (within `MAX_RELATIVE_ERROR` of the true output)
+     *
+     * ### params
+     *
+     * - `{pool} pool` - converter constants
+     * - `{uint64_t} amount_in` - amount input
+     */
+    static double approximate( const fast::pool& pool, const uint64_t amount_in )
+    {
+        const double u = static_cast<double>(amount_in) * pool.inverse_reserve_in;
+
+        // equal weights => u / (1 + u)
+        if ( pool.weight_ratio == 0 ) return pool.scale * (u / (1 + u));
+        return pool.scale * one_minus_exp( pool.weight_ratio * log1p( u ) );
+    }
+
+    /**
+     * ## STATIC `get_amount_out_interval`
+     *
+     * Given an input amount of an asset and a pool, returns `[lower, upper]` bounds of the output amount
+     *
+     * ### params
+     *
+     * - `{pool} pool` - converter constants
+     * - `{uint64_t} amount_in` - amount input
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::fast::pool pool = bancor::hop{ 45851931234, 500000, 125682033533, 500000, 2000 };
+     *
+     * const bancor::fast::interval out = bancor::fast::get_amount_out_interval( pool, 10000 );
+     * // => { lower: 27299, upper: 27301 }
+     * ```
+     */
+    static interval get_amount_out_interval( const fast::pool& pool, const uint64_t amount_in )
+    {
+        // checks
+        eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+
+        // calculations (the true output is below reserve_out, the integer kernel within `margin` of it)
+        const double estimate = approximate( pool, amount_in );
+        const double lower = estimate * (1 - MAX_RELATIVE_ERROR) - pool.margin;
+        const double upper = estimate * (1 + MAX_RELATIVE_ERROR) + 1;
+
+        return interval{
+            lower < 1 ? 0 : static_cast<uint64_t>(lower),
+            upper >= static_cast<double>(pool.reserve_out) ? pool.reserve_out : static_cast<uint64_t>(upper)
+        };
+    }
+
+    /**
+     * ## STATIC `get_amount_out_interval`
+     *
+     * Given an input amount of an asset and pair reserves, returns `[lower, upper]` bounds of the output amount
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint64_t} fee` - trading fee (pips 1/10000 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::fast::interval out = bancor::fast::get_amount_out_interval( 10000, 45851931234, 500000, 125682033533, 500000, 2000 );
+     * // => { lower: 27299, upper: 27301 }
+     * ```
+     */
+    static interval get_amount_out_interval( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint64_t fee )
+    {
+        return get_amount_out_interval( fast::pool( hop{ reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee } ), amount_in );
+    }
+
+    /**
+     * ## STATIC `get_amount_out`
+     *
+     * Given an input amount of an asset and a pool, returns a guaranteed lower bound of the output amount
+     *
+     * Meant for screening many pools; candidates are re-priced with `bancor::get_amount_out`.
+     *
+     * ### params
+     *
+     * - `{pool} pool` - converter constants
+     * - `{uint64_t} amount_in` - amount input
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::fast::pool pool = bancor::hop{ 45851931234, 500000, 125682033533, 500000, 2000 };
+     *
+     * const uint64_t lower = bancor::fast::get_amount_out( pool, 10000 );
+     * // => 27299
+     * ```
+     */
+    static uint64_t get_amount_out( const fast::pool& pool, const uint64_t amount_in )
+    {
+        return get_amount_out_interval( pool, amount_in ).lower;
+    }
+}
+}
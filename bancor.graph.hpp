@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "bancor.route.hpp"
+#include "bancor.multi.hpp"
+#include "bancor.legacy.hpp"
+
+namespace bancor {
+
+    /**
+     * ## STRUCT `token`
+     *
+     * Token of the converter graph (symbol code & token contract)
+     *
+     * ### params
+     *
+     * - `{name} contract` - token contract
+     * - `{symbol_code} code` - token symbol code
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::token eos = { "eosio.token"_n, {"EOS"} };
+     * ```
+     */
+    struct token {
+        name            contract;
+        symbol_code     code;
+
+        friend bool operator==( const token& a, const token& b ) { return a.contract == b.contract && a.code == b.code; }
+        friend bool operator!=( const token& a, const token& b ) { return !(a == b); }
+        friend bool operator<( const token& a, const token& b )
+        {
+            if ( a.contract != b.contract ) return a.contract < b.contract;
+            return a.code < b.code;
+        }
+    };
+
+    /**
+     * ## STRUCT `graph`
+     *
+     * Token graph of every loaded `bancor::multi` and `bancor::legacy` converter
+     *
+     * Each reserve pair of a converter is a directed edge weighted by `-ln(spot price after fees)`, so the cost of a path
+     * is `-ln` of its best possible rate. Converters are added once and refreshed in place (`update_multi` / `update_legacy`),
+     * only recomputing their own edges, so the graph is reused across queries.
+     *
+     * ### params
+     *
+     * - `{vector<token>} tokens` - graph nodes
+     * - `{vector<converter>} converters` - loaded converters (indices are stable)
+     * - `{vector<vector<edge>>} edges` - outgoing edges of each token
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::graph graph;
+     * graph.load_multi();
+     * graph.load_legacy( "bnt2eoscnvrt"_n );
+     * ```
+     */
+    struct graph {
+        static constexpr uint8_t MAX_RESERVES = 8;
+
+        struct reserve {
+            uint32_t        token;
+            uint64_t        weight;
+            uint64_t        balance;
+        };
+
+        struct converter {
+            name            type;           // `bancor::multi::id` or `bancor::legacy::id`
+            name            code;           // converter contract account
+            symbol_code     currency;       // multi converter currency (empty for legacy converters)
+            uint64_t        fee = 0;
+            uint8_t         size = 0;
+            reserve         reserves[MAX_RESERVES] = {};
+        };
+
+        struct edge {
+            uint32_t        converter;
+            uint8_t         reserve_in;
+            uint8_t         reserve_out;
+            uint32_t        to;
+            double          cost;           // -ln(spot price after fees)
+        };
+
+        vector<bancor::token>               tokens;
+        vector<converter>                   converters;
+        vector<vector<edge>>                edges;
+
+        // token index, created when missing
+        uint32_t add_token( const bancor::token& item )
+        {
+            const auto itr = _tokens.find( item );
+            if ( itr != _tokens.end() ) return itr->second;
+
+            const uint32_t index = tokens.size();
+            tokens.push_back( item );
+            edges.emplace_back();
+            _tokens.emplace( item, index );
+            return index;
+        }
+
+        // token index, -1 when the token is not in the graph
+        int64_t find_token( const bancor::token& item ) const
+        {
+            const auto itr = _tokens.find( item );
+            return itr == _tokens.end() ? -1 : itr->second;
+        }
+
+        // converter index of a multi converter, -1 when not in the graph
+        int64_t find_multi( const symbol_code currency, const name code = bancor::multi::code ) const
+        {
+            const auto itr = _multi.find( { code.value, currency.raw() } );
+            return itr == _multi.end() ? -1 : itr->second;
+        }
+
+        // converter index of a legacy converter, -1 when not in the graph
+        int64_t find_legacy( const name code ) const
+        {
+            const auto itr = _legacy.find( code.value );
+            return itr == _legacy.end() ? -1 : itr->second;
+        }
+
+        // add or refresh a multi converter from its snapshot
+        uint32_t set_multi( const bancor::multi::snapshot& snapshot, const name code = bancor::multi::code )
+        {
+            converter item{ bancor::multi::id, code, snapshot.currency.code(), snapshot.fee };
+            for ( uint8_t i = 0; i < snapshot.size; ++i ) {
+                const bancor::multi::reserve& res = snapshot.reserves[i];
+                item.reserves[item.size++] = reserve{ add_token( { res.contract, snapshot.symbols[i] } ), res.weight, res.balance.amount > 0 ? static_cast<uint64_t>(res.balance.amount) : 0 };
+            }
+            return set_converter( _multi, { code.value, item.currency.raw() }, item );
+        }
+
+        // add or refresh a legacy converter from its snapshot
+        uint32_t set_legacy( const bancor::legacy::snapshot& snapshot )
+        {
+            converter item{ bancor::legacy::id, snapshot.code, symbol_code{}, snapshot.fee };
+            for ( uint8_t i = 0; i < snapshot.size; ++i ) {
+                const bancor::legacy::reserve& res = snapshot.reserves[i];
+                item.reserves[item.size++] = reserve{ add_token( { res.contract, snapshot.symbols[i] } ), res.weight, res.balance.amount > 0 ? static_cast<uint64_t>(res.balance.amount) : 0 };
+            }
+            return set_converter( _legacy, snapshot.code.value, item );
+        }
+
+        // add or refresh every converter of a multi converter contract (one table scan)
+        void load_multi( const name code = bancor::multi::code )
+        {
+            bancor::multi::converter_flat _converter( code, code.value );
+            for ( const auto& row : _converter ) set_multi( bancor::multi::load( row ), code );
+        }
+
+        // add or refresh a legacy converter account
+        void load_legacy( const name code )
+        {
+            set_legacy( bancor::legacy::load( code ) );
+        }
+
+        // re-read one multi converter (one table read) and recompute its edges only
+        uint32_t update_multi( const symbol_code currency, const name code = bancor::multi::code )
+        {
+            return set_multi( bancor::multi::load( currency, code ), code );
+        }
+
+        // re-read one legacy converter and recompute its edges only
+        uint32_t update_legacy( const name code )
+        {
+            return set_legacy( bancor::legacy::load( code ) );
+        }
+
+        // current reserves of an edge as a `bancor::hop`
+        bancor::hop get_hop( const edge& item ) const
+        {
+            const converter& conv = converters[item.converter];
+            const reserve& in = conv.reserves[item.reserve_in];
+            const reserve& out = conv.reserves[item.reserve_out];
+            return bancor::hop{ in.balance, in.weight, out.balance, out.weight, conv.fee };
+        }
+
+    private:
+        // -ln(reserve_out * weight_in / (reserve_in * weight_out) * (1 - fee)^2)
+        static double get_cost( const reserve& in, const reserve& out, const uint64_t fee )
+        {
+            const double fee_factor = static_cast<double>((formula::MAX_FEE - fee) * (formula::MAX_FEE - fee)) * 1e-12;
+            return -std::log( static_cast<double>(out.balance) * in.weight / (static_cast<double>(in.balance) * out.weight) * fee_factor );
+        }
+
+        // add or replace the converter registered under `id` and rebuild its edges
+        template <typename K>
+        uint32_t set_converter( std::map<K, uint32_t>& ids, const K& id, const converter& item )
+        {
+            uint32_t slot;
+            const auto itr = ids.find( id );
+            if ( itr == ids.end() ) {
+                slot = converters.size();
+                converters.push_back( item );
+                ids.emplace( id, slot );
+            } else {
+                slot = itr->second;
+                remove_edges( slot );
+                converters[slot] = item;
+            }
+
+            // tradable pairs only (empty reserves, zero weights & 100% fee have no price); out of range
+            // weights & fees would fail `get_amount_out`, so the converter is kept without edges (inactive)
+            const converter& conv = converters[slot];
+            if ( conv.fee >= formula::MAX_FEE ) return slot;
+            for ( uint8_t i = 0; i < conv.size; ++i ) {
+                if ( conv.reserves[i].weight > formula::MAX_WEIGHT ) return slot;
+            }
+            for ( uint8_t i = 0; i < conv.size; ++i ) {
+                const reserve& in = conv.reserves[i];
+                if ( in.balance == 0 || in.weight == 0 ) continue;
+                for ( uint8_t j = 0; j < conv.size; ++j ) {
+                    const reserve& out = conv.reserves[j];
+                    if ( i == j || out.balance == 0 || out.weight == 0 || in.token == out.token ) continue;
+                    edges[in.token].push_back( edge{ slot, i, j, out.token, get_cost( in, out, conv.fee ) } );
+                }
+            }
+            return slot;
+        }
+
+        void remove_edges( const uint32_t index )
+        {
+            const converter& conv = converters[index];
+            for ( uint8_t i = 0; i < conv.size; ++i ) {
+                vector<edge>& list = edges[conv.reserves[i].token];
+                list.erase( std::remove_if( list.begin(), list.end(), [&]( const edge& item ) { return item.converter == index; } ), list.end() );
+            }
+        }
+
+        std::map<bancor::token, uint32_t>                   _tokens;
+        std::map<std::pair<uint64_t, uint64_t>, uint32_t>   _multi;    // (code, currency)
+        std::map<uint64_t, uint32_t>                        _legacy;   // code
+    };
+
+    /**
+     * ## STRUCT `route_quote`
+     *
+     * Priced route returned by `get_routes`
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_out` - exact output amount (`get_amount_out` on the route)
+     * - `{double} cost` - `-ln(spot rate after fees)` of the route
+     * - `{route} path` - hops in trade order (current reserves)
+     * - `{uint32_t[]} converters` - graph converter index of each hop
+     * - `{uint32_t[]} tokens` - graph token index of each hop input, then the final output
+     */
+    struct route_quote {
+        uint64_t        amount_out = 0;
+        double          cost = 0;
+        bancor::route   path;
+        uint32_t        converters[route::MAX_HOPS];
+        uint32_t        tokens[route::MAX_HOPS + 1];
+    };
+
+    namespace router {
+        struct candidate {
+            double          cost;
+            uint8_t         size;
+            uint32_t        tokens[route::MAX_HOPS + 1];
+            const graph::edge*  edges[route::MAX_HOPS];
+        };
+
+        // depth-first enumeration of simple paths `from` => `to` (at most `max_hops`)
+        static void search( const bancor::graph& graph, candidate& path, const uint32_t to, const uint8_t max_hops, vector<bool>& visited, vector<candidate>& res )
+        {
+            const uint32_t from = path.tokens[path.size];
+            for ( const graph::edge& item : graph.edges[from] ) {
+                if ( visited[item.to] ) continue;
+                if ( item.to != to && path.size + 1 >= max_hops ) continue;
+
+                path.edges[path.size] = &item;
+                path.tokens[path.size + 1] = item.to;
+                path.cost += item.cost;
+                path.size += 1;
+
+                if ( item.to == to ) {
+                    res.push_back( path );
+                } else {
+                    visited[item.to] = true;
+                    search( graph, path, to, max_hops, visited, res );
+                    visited[item.to] = false;
+                }
+
+                path.size -= 1;
+                path.cost -= item.cost;
+            }
+        }
+    }
+
+    /**
+     * ## STATIC `get_routes`
+     *
+     * Given an input amount, input and output tokens, returns the `k` best routes of the graph (best output first)
+     *
+     * Simple paths up to `max_hops` are ranked by spot price; since bonding curves are concave, `amount_in * spot rate`
+     * bounds the exact output, so candidates are re-priced with `get_amount_out` only until that bound falls below the k-th best.
+     *
+     * ### params
+     *
+     * - `{graph} graph` - converter graph
+     * - `{token} token_in` - input token
+     * - `{token} token_out` - output token
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint8_t} [k=3]` - number of routes
+     * - `{uint8_t} [max_hops=3]` - maximum hops per route
+     *
+     * ### example
+     *
+     * ```c++
+     * const vector<bancor::route_quote> quotes = bancor::get_routes( graph, { "eosio.token"_n, {"EOS"} }, { "tethertether"_n, {"USDT"} }, 10000 );
+     * // quotes[0].amount_out => 21402
+     * ```
+     */
+    static vector<bancor::route_quote> get_routes( const bancor::graph& graph, const bancor::token& token_in, const bancor::token& token_out, const uint64_t amount_in, const uint8_t k = 3, const uint8_t max_hops = 3 )
+    {
+        // checks
+        eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(max_hops > 0 && max_hops <= route::MAX_HOPS, "sx.bancor: INVALID_ROUTE");
+
+        vector<bancor::route_quote> res;
+        const int64_t from = graph.find_token( token_in );
+        const int64_t to = graph.find_token( token_out );
+        if ( from < 0 || to < 0 || from == to || k == 0 ) return res;
+
+        // candidates ranked by spot price
+        vector<router::candidate> candidates;
+        vector<bool> visited( graph.tokens.size(), false );
+        router::candidate path{};
+        path.tokens[0] = from;
+        visited[from] = true;
+        router::search( graph, path, to, max_hops, visited, candidates );
+        std::sort( candidates.begin(), candidates.end(), []( const router::candidate& a, const router::candidate& b ) { return a.cost < b.cost; } );
+
+        // exact re-pricing, stops when the spot bound cannot beat the k-th best
+        for ( const router::candidate& item : candidates ) {
+            const double bound = static_cast<double>(amount_in) * std::exp( -item.cost ) * (1 + 1e-9);
+            if ( res.size() == k && bound < static_cast<double>(res.back().amount_out) ) break;
+
+            bancor::route_quote current;
+            current.cost = item.cost;
+            for ( uint8_t i = 0; i < item.size; ++i ) {
+                current.path.push_back( graph.get_hop( *item.edges[i] ) );
+                current.converters[i] = item.edges[i]->converter;
+                current.tokens[i] = item.tokens[i];
+            }
+            current.tokens[item.size] = item.tokens[item.size];
+            current.amount_out = bancor::get_amount_out( current.path, amount_in );
+
+            // insert sorted by output (best first), keep k
+            auto itr = std::upper_bound( res.begin(), res.end(), current.amount_out, []( const uint64_t amount, const bancor::route_quote& item ) { return amount > item.amount_out; } );
+            if ( static_cast<size_t>(itr - res.begin()) >= k ) continue;
+            res.insert( itr, current );
+            if ( res.size() > k ) res.pop_back();
+        }
+        return res;
+    }
+}
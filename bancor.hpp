@@ -3,6 +3,8 @@
 #include <sx.safemath/safemath.hpp>
 #include <math.h>
 
+#include "bancor.formula.hpp"
+
 using namespace eosio;
 using namespace std;
 
@@ -34,11 +36,48 @@ namespace bancor {
      * const uint64_t fee = 2000;
      *
      * // Calculation
-     * const uint64_t amount_out = bancor::get_amount_out( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
-     * // => 27328
+     * const uint64_t amount_out = bancor::get_amount_out( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+     * // => 27300
      * ```
      */
     static uint64_t get_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint64_t fee )
+    {
+        // checks
+        eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(reserve_in > 0 && reserve_out > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        eosio::check(reserve_weight_in > 0 && reserve_weight_out > 0, "sx.bancor: INVALID_WEIGHT");
+        eosio::check(reserve_weight_in <= formula::MAX_WEIGHT && reserve_weight_out <= formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+        eosio::check(fee <= formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+        // calculations
+        return formula::amount_out( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+    }
+
+    /**
+     * ## STATIC `get_amount_out_double`
+     *
+     * Reference implementation of `get_amount_out` using double precision `pow()`
+     *
+     * Not used by any pricing path: results depend on the platform floating point implementation,
+     * kept only to compare against the fixed-point engine.
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint64_t} fee` - trading fee (pips 1/10000 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t amount_out = bancor::get_amount_out_double( 10000, 45851931234, 50000, 125682033533, 50000, 2000 );
+     * // => 27300
+     * ```
+     */
+    static uint64_t get_amount_out_double( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint64_t fee )
     {
         // checks
         eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
@@ -47,9 +86,9 @@ namespace bancor {
 
         // calculations
         double weight_ratio = static_cast<double>(reserve_weight_in) / reserve_weight_out;
-        auto amount_out = reserve_out * pow ( static_cast<double>(amount_in) / (reserve_in + amount_in), weight_ratio ) ;
+        auto amount_out = reserve_out * ( 1 - pow ( static_cast<double>(reserve_in) / (static_cast<double>(reserve_in) + amount_in), weight_ratio ) );
 
-        return amount_out  * pow ( 1 - static_cast<double> (fee) / 1000000, 2);
+        return amount_out * pow ( 1 - static_cast<double> (fee) / 1000000, 2);
     }
 
     /**
@@ -59,7 +98,7 @@ namespace bancor {
      *
      * ### params
      *
-     * - `{uint64_t} amount_out` - amount input
+     * - `{uint64_t} amount_out` - amount output
      * - `{uint64_t} reserve_in` - reserve input
      * - `{uint64_t} reserve_weight_in` - reserve input weight
      * - `{uint64_t} reserve_out` - reserve output
@@ -70,7 +109,7 @@ namespace bancor {
      *
      * ```c++
      * // Inputs
-     * const uint64_t amount_out = 27328;
+     * const uint64_t amount_out = 27300;
      * const uint64_t reserve_in = 45851931234;
      * const uint64_t reserve_weight_in = 50000;
      * const uint64_t reserve_out = 125682033533;
@@ -85,11 +124,26 @@ namespace bancor {
     static uint64_t get_amount_in( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint64_t fee )
     {
         // checks
-        check(false, "sx.bancor: TODO");
         eosio::check(amount_out > 0, "sx.bancor: INSUFFICIENT_OUTPUT_AMOUNT");
         eosio::check(reserve_in > 0 && reserve_out > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        eosio::check(reserve_weight_in > 0 && reserve_weight_out > 0, "sx.bancor: INVALID_WEIGHT");
+        eosio::check(reserve_weight_in <= formula::MAX_WEIGHT && reserve_weight_out <= formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+        eosio::check(fee < formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+        // undo `(ratio_after_fee * reserve_out) >> 64` (rounded up), below 2^64 so the fee step cannot overflow
+        eosio::check(amount_out < reserve_out, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        const uint128_t ratio_after_fee = ((static_cast<uint128_t>(amount_out) << 64) + reserve_out - 1) / reserve_out;
+
+        // undo fee applied twice => ratio_after_fee / (1 - fee)^2 (rounded up)
+        const uint64_t fee_factor = (formula::MAX_FEE - fee) * (formula::MAX_FEE - fee);
+        const uint128_t ratio = (ratio_after_fee * (formula::MAX_FEE * formula::MAX_FEE) + fee_factor - 1) / fee_factor;
+        eosio::check(ratio < formula::fixed_1(), "sx.bancor: INSUFFICIENT_LIQUIDITY");
+
+        // calculations
+        const uint128_t amount_in = formula::source_amount( ratio, reserve_in, reserve_weight_in, reserve_weight_out );
+        eosio::check(amount_in <= UINT64_MAX, "sx.bancor: INSUFFICIENT_LIQUIDITY");
 
-        return 0;
+        return static_cast<uint64_t>(amount_in);
     }
 
     /**
@@ -124,7 +178,318 @@ namespace bancor {
     {
         eosio::check(amount_a > 0, "sx.bancor: INSUFFICIENT_AMOUNT");
         eosio::check(reserve_a > 0 && reserve_b > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
-        const uint64_t amount_b = safemath::mul(amount_a, reserve_b * 1000000 / reserve_weight_b) / (reserve_a * 1000000 / reserve_weight_a);
+        eosio::check(reserve_weight_a > 0 && reserve_weight_b > 0, "sx.bancor: INVALID_WEIGHT");
+
+        // amount_a * (reserve_b / reserve_weight_b) / (reserve_a / reserve_weight_a) => single full precision division
+        const uint64_t amount_b = safemath::mul_div(amount_a, safemath::mul(reserve_b, reserve_weight_a), safemath::mul(reserve_a, reserve_weight_b));
         return amount_b;
     }
+
+    /**
+     * ## STRUCT `price`
+     *
+     * Quote, prices and impact of one trade (returned by `get_price`)
+     *
+     * Prices are output per input in Q.64 after fees; impacts are in pips (1/10000 of 1%), rounded up.
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_out` - exact `get_amount_out`
+     * - `{uint128_t} spot_price` - price of an infinitesimal trade before the trade
+     * - `{uint128_t} marginal_price` - price of the next unit after the trade
+     * - `{uint64_t} price_impact` - `1 - marginal_price / spot_price`
+     * - `{uint64_t} slippage` - `1 - (amount_out / amount_in) / spot_price` (execution price versus spot)
+     */
+    struct price {
+        uint64_t    amount_out;
+        uint128_t   spot_price;
+        uint128_t   marginal_price;
+        uint64_t    price_impact;
+        uint64_t    slippage;
+    };
+
+    /**
+     * ## STATIC `spot_price`
+     *
+     * Given pair reserves, returns the price (output per input) of an infinitesimal trade after fees in Q.64
+     *
+     * `(reserve_out / reserve_weight_out) / (reserve_in / reserve_weight_in) * (1 - fee)^2`
+     *
+     * ### params
+     *
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint64_t} fee` - trading fee (pips 1/10000 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint128_t spot = bancor::spot_price( 45851931234, 500000, 125682033533, 500000, 2000 );
+     * // => 2.7301... * 2^64
+     * ```
+     */
+    static uint128_t spot_price( const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint64_t fee )
+    {
+        // checks
+        eosio::check(reserve_in > 0 && reserve_out > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        eosio::check(reserve_weight_in > 0 && reserve_weight_out > 0, "sx.bancor: INVALID_WEIGHT");
+        eosio::check(reserve_weight_in <= formula::MAX_WEIGHT && reserve_weight_out <= formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+        eosio::check(fee <= formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+        // reserves * weights * fee factor < 2^124 => single division
+        const uint64_t fee_factor = (formula::MAX_FEE - fee) * (formula::MAX_FEE - fee);
+        const uint128_t numerator = safemath::mul( reserve_out, reserve_weight_in ) * fee_factor;
+        const uint128_t denominator = safemath::mul( reserve_in, reserve_weight_out ) * (formula::MAX_FEE * formula::MAX_FEE);
+        return formula::fraction_q64( numerator, denominator );
+    }
+
+    /**
+     * ## STATIC `get_price`
+     *
+     * Given an input amount of an asset and pair reserves, returns the output amount, spot & marginal prices and impacts
+     *
+     * One `target_ratio` evaluation serves every field: with `p = reserve_weight_in / reserve_weight_out` and
+     * `power = (reserve_in / (reserve_in + amount_in))^p = 1 - ratio`, the marginal price is
+     * `spot_price * power * reserve_in / (reserve_in + amount_in)` and the execution price is
+     * `spot_price * ratio * reserve_in / (amount_in * p)` (fees cancel out of both impacts).
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint64_t} fee` - trading fee (pips 1/10000 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::price res = bancor::get_price( 10000000000, 45851931234, 500000, 125682033533, 500000, 2000 );
+     * // res.amount_out => 22412798512 (same as get_amount_out)
+     * // res.price_impact => 326033 (32.60%)
+     * // res.slippage => 179045 (17.90%)
+     * ```
+     */
+    static bancor::price get_price( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint64_t fee )
+    {
+        // checks
+        eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+
+        bancor::price res;
+        res.spot_price = bancor::spot_price( reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+
+        // single kernel evaluation
+        const uint64_t ratio = static_cast<uint64_t>( formula::target_ratio( amount_in, reserve_in, reserve_weight_in, reserve_weight_out ) );
+        const uint64_t fee_factor = (formula::MAX_FEE - fee) * (formula::MAX_FEE - fee);
+        const uint64_t ratio_after_fee = safemath::mul_div( ratio, fee_factor, formula::MAX_FEE * formula::MAX_FEE );
+        res.amount_out = static_cast<uint64_t>(safemath::mul( ratio_after_fee, reserve_out ) >> 64);
+
+        // marginal / spot = power * reserve_in / (reserve_in + amount_in)
+        const uint64_t power = UINT64_MAX - ratio;
+        const uint64_t marginal = safemath::mul_div( power, reserve_in, static_cast<uint128_t>(reserve_in) + amount_in );
+        res.marginal_price = formula::mul_q64( res.spot_price, marginal );
+
+        // execution / spot = ratio * reserve_in / (amount_in * p) < 1 (concave curve, ratio rounded down)
+        const uint64_t execution = safemath::mul_div( ratio, safemath::mul( reserve_in, reserve_weight_out ), safemath::mul( amount_in, reserve_weight_in ) );
+
+        // 1 - x in pips, rounded up
+        const auto to_pips = []( const uint64_t x ) {
+            return formula::MAX_FEE - static_cast<uint64_t>(safemath::mul( x, formula::MAX_FEE ) >> 64);
+        };
+        res.price_impact = to_pips( marginal );
+        res.slippage = to_pips( execution );
+        return res;
+    }
+
+    /**
+     * ## STATIC `marginal_price`
+     *
+     * Given an input amount of an asset and pair reserves, returns the price (output per input) of the next unit after the trade in Q.64
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint64_t} fee` - trading fee (pips 1/10000 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint128_t price = bancor::marginal_price( 10000000000, 45851931234, 500000, 125682033533, 500000, 2000 );
+     * // => 1.8399... * 2^64
+     * ```
+     */
+    static uint128_t marginal_price( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint64_t fee )
+    {
+        return bancor::get_price( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee ).marginal_price;
+    }
+
+    /**
+     * ## STATIC `price_impact`
+     *
+     * Given an input amount of an asset and pair reserves, returns how far the trade moves the price: `1 - marginal_price / spot_price` in pips (rounded up)
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint64_t} fee` - trading fee (pips 1/10000 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t impact = bancor::price_impact( 10000000000, 45851931234, 500000, 125682033533, 500000, 2000 );
+     * // => 326033 (32.60%)
+     * ```
+     */
+    static uint64_t price_impact( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint64_t fee )
+    {
+        return bancor::get_price( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee ).price_impact;
+    }
+
+    /**
+     * ## STATIC `purchase_return`
+     *
+     * Given a reserve amount deposited into a converter, returns the smart tokens (relay, e.g. `EOSBNT`) issued
+     *
+     * `supply * ((1 + amount / reserve_balance) ^ (reserve_weight / 1000000) - 1) * (1 - fee)` rounded down (fee applied once)
+     *
+     * ### params
+     *
+     * - `{uint64_t} supply` - smart token supply
+     * - `{uint64_t} reserve_balance` - reserve balance
+     * - `{uint64_t} reserve_weight` - reserve weight
+     * - `{uint64_t} amount` - reserve amount deposited
+     * - `{uint64_t} fee` - conversion fee (pips 1/10000 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t supply = bancor::purchase_return( 1000000000, 579884155, 500000, 10000000, 2000 );
+     * // => 8568383
+     * ```
+     */
+    static uint64_t purchase_return( const uint64_t supply, const uint64_t reserve_balance, const uint64_t reserve_weight, const uint64_t amount, const uint64_t fee )
+    {
+        // checks
+        eosio::check(amount > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(supply > 0 && reserve_balance > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        eosio::check(reserve_weight > 0 && reserve_weight <= formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+        eosio::check(fee <= formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+        // calculations
+        return formula::purchase_return( supply, reserve_balance, reserve_weight, amount, fee );
+    }
+
+    /**
+     * ## STATIC `sale_return`
+     *
+     * Given smart tokens (relay, e.g. `EOSBNT`) sold to a converter, returns the reserve amount received
+     *
+     * `reserve_balance * (1 - (1 - amount / supply) ^ (1000000 / reserve_weight)) * (1 - fee)` rounded down (fee applied once)
+     *
+     * ### params
+     *
+     * - `{uint64_t} supply` - smart token supply
+     * - `{uint64_t} reserve_balance` - reserve balance
+     * - `{uint64_t} reserve_weight` - reserve weight
+     * - `{uint64_t} amount` - smart tokens sold (`<= supply`)
+     * - `{uint64_t} fee` - conversion fee (pips 1/10000 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t amount = bancor::sale_return( 1000000000, 579884155, 500000, 10000000, 2000 );
+     * // => 11516614
+     * ```
+     */
+    static uint64_t sale_return( const uint64_t supply, const uint64_t reserve_balance, const uint64_t reserve_weight, const uint64_t amount, const uint64_t fee )
+    {
+        // checks
+        eosio::check(amount > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(supply > 0 && reserve_balance > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        eosio::check(amount <= supply, "sx.bancor: INSUFFICIENT_SUPPLY");
+        eosio::check(reserve_weight > 0 && reserve_weight <= formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+        eosio::check(fee <= formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+        // calculations
+        return formula::sale_return( supply, reserve_balance, reserve_weight, amount, fee );
+    }
+
+    /**
+     * ## STATIC `fund_cost`
+     *
+     * Given smart tokens to issue, returns the amount of one reserve required to fund them (deposited in every reserve, no fee)
+     *
+     * `reserve_balance * ((1 + amount / supply) ^ (1000000 / reserve_ratio) - 1)` rounded up
+     *
+     * ### params
+     *
+     * - `{uint64_t} supply` - smart token supply
+     * - `{uint64_t} reserve_balance` - reserve balance
+     * - `{uint64_t} reserve_ratio` - sum of the reserve weights (`<= 2000000`)
+     * - `{uint64_t} amount` - smart tokens issued
+     *
+     * ### example
+     *
+     * ```c++
+     * // EOSBNT: 500000 + 500000 weights
+     * const uint64_t eos = bancor::fund_cost( 1000000000, 579884155, 1000000, 10000000 );
+     * // => 5798842 (1% of the EOS reserve for 1% of the supply)
+     * ```
+     */
+    static uint64_t fund_cost( const uint64_t supply, const uint64_t reserve_balance, const uint64_t reserve_ratio, const uint64_t amount )
+    {
+        // checks
+        eosio::check(amount > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(supply > 0 && reserve_balance > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        eosio::check(reserve_ratio > 0 && reserve_ratio <= 2 * formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+
+        // calculations
+        const uint128_t cost = formula::fund_cost( supply, reserve_balance, reserve_ratio, amount );
+        eosio::check(cost <= UINT64_MAX, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        return static_cast<uint64_t>(cost);
+    }
+
+    /**
+     * ## STATIC `liquidate_return`
+     *
+     * Given smart tokens to liquidate, returns the amount of one reserve withdrawn (from every reserve, no fee)
+     *
+     * `reserve_balance * (1 - (1 - amount / supply) ^ (1000000 / reserve_ratio))` rounded down
+     *
+     * ### params
+     *
+     * - `{uint64_t} supply` - smart token supply
+     * - `{uint64_t} reserve_balance` - reserve balance
+     * - `{uint64_t} reserve_ratio` - sum of the reserve weights (`<= 2000000`)
+     * - `{uint64_t} amount` - smart tokens liquidated (`<= supply`)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t eos = bancor::liquidate_return( 1000000000, 579884155, 1000000, 10000000 );
+     * // => 5798841
+     * ```
+     */
+    static uint64_t liquidate_return( const uint64_t supply, const uint64_t reserve_balance, const uint64_t reserve_ratio, const uint64_t amount )
+    {
+        // checks
+        eosio::check(amount > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(supply > 0 && reserve_balance > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        eosio::check(amount <= supply, "sx.bancor: INSUFFICIENT_SUPPLY");
+        eosio::check(reserve_ratio > 0 && reserve_ratio <= 2 * formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+
+        // calculations
+        return formula::liquidate_return( supply, reserve_balance, reserve_ratio, amount );
+    }
 }
@@ -0,0 +1,379 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bancor.graph.hpp"
+
+/**
+ * Binary converter snapshot (off-chain): versioned fixed-layout file of every multi & legacy converter
+ *
+ * Layout (host byte order, checked on open): one `header`, then `count` fixed-size `record`s sorted by
+ * (type, code, currency). The reader maps the file and serves records in place: lookups are binary searches,
+ * quotes read the mapped reserves directly, nothing is allocated per converter.
+ */
+namespace bancor {
+namespace image {
+
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t ENDIAN = 0x01020304;
+    static constexpr uint8_t MAX_RESERVES = 8;
+
+    /**
+     * ## STRUCT `header`
+     *
+     * File header (64 bytes)
+     *
+     * ### params
+     *
+     * - `{char[8]} magic` - `"SXBANCOR"`
+     * - `{uint32_t} version` - format version (`VERSION`)
+     * - `{uint32_t} endian` - `ENDIAN` as written by the producer
+     * - `{uint32_t} header_size` - `sizeof( header )`
+     * - `{uint32_t} record_size` - `sizeof( record )`
+     * - `{uint64_t} count` - number of records
+     * - `{uint64_t} offset` - file offset of the first record
+     * - `{uint64_t} block_num` - chain position of the snapshot (producer defined)
+     * - `{uint64_t} checksum` - FNV-1a of the records
+     */
+    struct header {
+        char            magic[8];
+        uint32_t        version;
+        uint32_t        endian;
+        uint32_t        header_size;
+        uint32_t        record_size;
+        uint64_t        count;
+        uint64_t        offset;
+        uint64_t        block_num;
+        uint64_t        checksum;
+        uint64_t        reserved = 0;
+    };
+
+    /**
+     * ## STRUCT `record`
+     *
+     * One converter (288 bytes): `type` is `bancor::multi::id` or `bancor::legacy::id`, `currency` the raw smart token
+     * symbol of multi converters (0 for legacy converters), reserves in snapshot order
+     */
+    struct reserve_record {
+        uint64_t        symbol;         // raw symbol (code & precision)
+        uint64_t        contract;
+        uint64_t        weight;
+        int64_t         balance;
+    };
+
+    struct record {
+        uint64_t        type;
+        uint64_t        code;
+        uint64_t        currency;
+        uint64_t        fee;
+        uint64_t        size;
+        reserve_record  reserves[MAX_RESERVES];
+
+        // reserve index of a symbol code, -1 when missing
+        int8_t find( const symbol_code reserve ) const
+        {
+            for ( uint8_t i = 0; i < size; ++i ) {
+                if ( symbol( reserves[i].symbol ).code() == reserve ) return i;
+            }
+            return -1;
+        }
+    };
+
+    static_assert( sizeof( header ) == 64, "sx.bancor::image: header layout" );
+    static_assert( sizeof( record ) == 40 + 32 * MAX_RESERVES, "sx.bancor::image: record layout" );
+
+    // FNV-1a 64
+    static uint64_t checksum( const void* data, const size_t size )
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>( data );
+        uint64_t res = 0xcbf29ce484222325;
+        for ( size_t i = 0; i < size; ++i ) res = (res ^ bytes[i]) * 0x100000001b3;
+        return res;
+    }
+
+    static bool operator<( const record& a, const record& b )
+    {
+        if ( a.type != b.type ) return a.type < b.type;
+        if ( a.code != b.code ) return a.code < b.code;
+        return a.currency < b.currency;
+    }
+
+    /**
+     * ## STATIC `make_record`
+     *
+     * Fixed-layout record of a loaded multi or legacy converter
+     */
+    static bancor::image::record make_record( const bancor::multi::snapshot& converter, const name code = bancor::multi::code )
+    {
+        bancor::image::record res = {};
+        res.type = bancor::multi::id.value;
+        res.code = code.value;
+        res.currency = converter.currency.raw();
+        res.fee = converter.fee;
+        res.size = converter.size;
+        for ( uint8_t i = 0; i < converter.size; ++i ) {
+            const bancor::multi::reserve& reserve = converter.reserves[i];
+            res.reserves[i] = reserve_record{ symbol( converter.symbols[i], reserve.balance.symbol.precision() ).raw(), reserve.contract.value, reserve.weight, reserve.balance.amount };
+        }
+        return res;
+    }
+
+    static bancor::image::record make_record( const bancor::legacy::snapshot& converter )
+    {
+        bancor::image::record res = {};
+        res.type = bancor::legacy::id.value;
+        res.code = converter.code.value;
+        res.fee = converter.fee;
+        res.size = converter.size;
+        for ( uint8_t i = 0; i < converter.size; ++i ) {
+            const bancor::legacy::reserve& reserve = converter.reserves[i];
+            res.reserves[i] = reserve_record{ symbol( converter.symbols[i], reserve.balance.symbol.precision() ).raw(), reserve.contract.value, reserve.weight, reserve.balance.amount };
+        }
+        return res;
+    }
+
+    /**
+     * ## STATIC `get_multi` / `get_legacy`
+     *
+     * Snapshot of a mapped record (no allocation)
+     */
+    static bancor::multi::snapshot get_multi( const bancor::image::record& item )
+    {
+        bancor::multi::snapshot res;
+        res.currency = symbol( item.currency );
+        res.fee = item.fee;
+        res.size = item.size;
+        for ( uint8_t i = 0; i < item.size; ++i ) {
+            const reserve_record& reserve = item.reserves[i];
+            res.symbols[i] = symbol( reserve.symbol ).code();
+            res.reserves[i] = bancor::multi::reserve{ name( reserve.contract ), reserve.weight, asset( reserve.balance, symbol( reserve.symbol ) ) };
+        }
+        return res;
+    }
+
+    static bancor::legacy::snapshot get_legacy( const bancor::image::record& item )
+    {
+        bancor::legacy::snapshot res;
+        res.code = name( item.code );
+        res.fee = item.fee;
+        res.size = item.size;
+        for ( uint8_t i = 0; i < item.size; ++i ) {
+            const reserve_record& reserve = item.reserves[i];
+            res.symbols[i] = symbol( reserve.symbol ).code();
+            res.reserves[i] = bancor::legacy::reserve{ name( reserve.contract ), reserve.weight, asset( reserve.balance, symbol( reserve.symbol ) ) };
+        }
+        return res;
+    }
+
+    /**
+     * ## STATIC `get_hop`
+     *
+     * Reserve pair of a mapped record
+     */
+    static bancor::hop get_hop( const bancor::image::record& item, const symbol_code reserve_in, const symbol_code reserve_out )
+    {
+        const int8_t i = item.find( reserve_in );
+        const int8_t j = item.find( reserve_out );
+        check( i >= 0 && j >= 0, "sx.bancor::image: reserve balance symbol does not exist");
+
+        const reserve_record& in = item.reserves[i];
+        const reserve_record& out = item.reserves[j];
+        check( in.balance >= 0 && out.balance >= 0, "sx.bancor::image: invalid reserve balance");
+        return bancor::hop{ static_cast<uint64_t>(in.balance), in.weight, static_cast<uint64_t>(out.balance), out.weight, item.fee };
+    }
+
+    /**
+     * ## STATIC `get_amount_out`
+     *
+     * Quote a reserve pair of a mapped record (same result as the loaded converter)
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::image::record* eosbnt = file.find_multi( {"EOSBNT"} );
+     * const uint64_t out = bancor::image::get_amount_out( *eosbnt, {"EOS"}, {"BNT"}, 10000 );
+     * // => 37177074374
+     * ```
+     */
+    static uint64_t get_amount_out( const bancor::image::record& item, const symbol_code reserve_in, const symbol_code reserve_out, const uint64_t amount_in )
+    {
+        const bancor::hop pair = get_hop( item, reserve_in, reserve_out );
+        return bancor::get_amount_out( amount_in, pair.reserve_in, pair.reserve_weight_in, pair.reserve_out, pair.reserve_weight_out, pair.fee );
+    }
+
+    /**
+     * ## STRUCT `writer`
+     *
+     * Collects converters and writes a snapshot file (temporary file renamed into place)
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::image::writer out;
+     * bancor::multi::converter _converter( bancor::multi::code, bancor::multi::code.value );
+     * for ( const auto& row : _converter ) out.add( bancor::multi::load( row ) );
+     * out.add( bancor::legacy::load( "bnt2eoscnvrt"_n ) );
+     * out.write( "converters.bin", block_num );
+     * ```
+     */
+    struct writer {
+        vector<bancor::image::record>   records;
+
+        void add( const bancor::multi::snapshot& converter, const name code = bancor::multi::code ) { records.push_back( make_record( converter, code ) ); }
+        void add( const bancor::legacy::snapshot& converter ) { records.push_back( make_record( converter ) ); }
+
+        void write( const std::string& path, const uint64_t block_num = 0 )
+        {
+            std::sort( records.begin(), records.end() );
+            for ( size_t i = 1; i < records.size(); ++i ) check( records[i - 1] < records[i], "sx.bancor::image: duplicate converter");
+
+            bancor::image::header head = {};
+            std::memcpy( head.magic, "SXBANCOR", sizeof( head.magic ) );
+            head.version = VERSION;
+            head.endian = ENDIAN;
+            head.header_size = sizeof( header );
+            head.record_size = sizeof( record );
+            head.count = records.size();
+            head.offset = sizeof( header );
+            head.block_num = block_num;
+            head.checksum = checksum( records.data(), records.size() * sizeof( record ) );
+
+            const std::string temporary = path + ".tmp";
+            FILE* file = std::fopen( temporary.c_str(), "wb" );
+            check( file != nullptr, "sx.bancor::image: cannot create file");
+            const bool written = std::fwrite( &head, sizeof( head ), 1, file ) == 1
+                && std::fwrite( records.data(), sizeof( record ), records.size(), file ) == records.size();
+            const bool closed = std::fclose( file ) == 0;
+            check( written && closed, "sx.bancor::image: cannot write file");
+            check( std::rename( temporary.c_str(), path.c_str() ) == 0, "sx.bancor::image: cannot rename file");
+        }
+    };
+
+    /**
+     * ## STRUCT `file`
+     *
+     * Read-only memory-mapped snapshot (records served in place)
+     *
+     * Opening checks the header (magic, version, byte order, layout sizes & file length) and the type & reserve count
+     * of every record; `verify()` checks the record checksum.
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::image::file file( "converters.bin" );
+     * // file.size() => 3
+     * const bancor::image::record* eosbnt = file.find_multi( {"EOSBNT"} );
+     * const uint64_t out = bancor::image::get_amount_out( *eosbnt, {"EOS"}, {"BNT"}, 10000 );
+     *
+     * bancor::graph graph;
+     * bancor::image::load( graph, file );
+     * ```
+     */
+    struct file {
+        explicit file( const std::string& path )
+        {
+            const int fd = ::open( path.c_str(), O_RDONLY );
+            check( fd >= 0, "sx.bancor::image: cannot open file");
+            struct stat info;
+            const bool sized = ::fstat( fd, &info ) == 0 && static_cast<size_t>(info.st_size) >= sizeof( header );
+            if ( sized ) {
+                _length = info.st_size;
+                _data = ::mmap( nullptr, _length, PROT_READ, MAP_PRIVATE, fd, 0 );
+            }
+            ::close( fd );
+            check( sized, "sx.bancor::image: file too small");
+            check( _data != MAP_FAILED, "sx.bancor::image: cannot map file");
+
+            // unmapped again when the contents are rejected
+            try {
+                validate();
+            } catch ( ... ) {
+                ::munmap( _data, _length );
+                throw;
+            }
+        }
+
+        file( const file& ) = delete;
+        file& operator=( const file& ) = delete;
+        ~file() { if ( _data != MAP_FAILED ) ::munmap( _data, _length ); }
+
+        const bancor::image::header& get_header() const { return *static_cast<const header*>( _data ); }
+        uint64_t size() const { return get_header().count; }
+        const bancor::image::record& operator[]( const size_t index ) const { return _records[index]; }
+        const bancor::image::record* begin() const { return _records; }
+        const bancor::image::record* end() const { return _records + size(); }
+
+        bool verify() const { return checksum( _records, size() * sizeof( record ) ) == get_header().checksum; }
+
+        // sort key of a record (type, code, currency), the other members left empty
+        static bancor::image::record key( const uint64_t type, const uint64_t code, const uint64_t currency )
+        {
+            bancor::image::record res{};
+            res.type = type;
+            res.code = code;
+            res.currency = currency;
+            return res;
+        }
+
+        // binary search, nullptr when missing
+        const bancor::image::record* find_multi( const symbol_code currency, const name code = bancor::multi::code ) const
+        {
+            const auto itr = std::lower_bound( begin(), end(), key( bancor::multi::id.value, code.value, currency.raw() << 8 ) );
+            if ( itr == end() || itr->type != bancor::multi::id.value || itr->code != code.value || symbol( itr->currency ).code() != currency ) return nullptr;
+            return itr;
+        }
+
+        const bancor::image::record* find_legacy( const name code ) const
+        {
+            const auto itr = std::lower_bound( begin(), end(), key( bancor::legacy::id.value, code.value, 0 ) );
+            if ( itr == end() || itr->type != bancor::legacy::id.value || itr->code != code.value ) return nullptr;
+            return itr;
+        }
+
+    private:
+        void validate()
+        {
+            const bancor::image::header& head = get_header();
+            check( std::memcmp( head.magic, "SXBANCOR", sizeof( head.magic ) ) == 0, "sx.bancor::image: invalid magic");
+            check( head.version == VERSION, "sx.bancor::image: unsupported version");
+            check( head.endian == ENDIAN, "sx.bancor::image: byte order mismatch");
+            check( head.header_size == sizeof( header ) && head.record_size == sizeof( record ), "sx.bancor::image: layout mismatch");
+            check( head.offset >= sizeof( header ) && head.offset <= _length && head.offset % alignof( record ) == 0, "sx.bancor::image: invalid offset");
+            check( head.count <= (_length - head.offset) / sizeof( record ), "sx.bancor::image: truncated file");
+            _records = reinterpret_cast<const record*>( static_cast<const char*>( _data ) + head.offset );
+
+            // records are read in place => bound every reserve array once
+            for ( const bancor::image::record& item : *this ) {
+                check( item.size <= MAX_RESERVES, "sx.bancor::image: invalid record");
+                check( item.type == bancor::multi::id.value || item.type == bancor::legacy::id.value, "sx.bancor::image: invalid record");
+            }
+        }
+
+        void*               _data = MAP_FAILED;
+        size_t              _length = 0;
+        const record*       _records = nullptr;
+    };
+
+    /**
+     * ## STATIC `load`
+     *
+     * Add every converter of a snapshot file to a graph
+     */
+    static void load( bancor::graph& graph, const bancor::image::file& file )
+    {
+        for ( const bancor::image::record& item : file ) {
+            if ( item.type == bancor::multi::id.value ) graph.set_multi( get_multi( item ), name( item.code ) );
+            else graph.set_legacy( get_legacy( item ) );
+        }
+    }
+}
+}
@@ -5,6 +5,8 @@
 #include <eosio/asset.hpp>
 #include <eosio/singleton.hpp>
 
+#include "bancor.route.hpp"
+
 namespace bancor {
 
 using eosio::name;
@@ -122,6 +124,209 @@ namespace legacy {
     };
     typedef eosio::multi_index< "reserves"_n, reserves_row > reserves;
 
+    /**
+     * ## TABLE `accounts`
+     *
+     * Token balances of an account (`eosio.token` layout, scope is the owner)
+     *
+     * ### params
+     *
+     * - `{asset} balance` - token balance
+     *
+     * ### example
+     *
+     * ```json
+     * {
+     *     "balance": "55988.4608 EOS"
+     * }
+     * ```
+     */
+    struct [[eosio::table("accounts")]] accounts_row {
+        asset       balance;
+
+        uint64_t primary_key() const { return balance.symbol.code().raw(); }
+    };
+    typedef eosio::multi_index< "accounts"_n, accounts_row > accounts;
+
+    /**
+     * ## STRUCT `snapshot`
+     *
+     * Flat copy of a converter (fee, reserve contracts, weights & balances) without per-call allocations
+     *
+     * Reserves keep the `reserves` table order (by symbol code); accessors return references into the snapshot.
+     *
+     * ### params
+     *
+     * - `{name} code` - converter contract account
+     * - `{uint64_t} fee` - conversion fee for this converter
+     * - `{uint8_t} size` - number of reserves (`<= MAX_RESERVES`)
+     * - `{symbol_code[]} symbols` - reserve symbol codes
+     * - `{reserve[]} reserves` - reserve contract, weight & balance
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::legacy::snapshot converter = bancor::legacy::load( "bnt2eoscnvrt"_n );
+     * const bancor::legacy::reserve& reserve0 = converter.get( {"EOS"} );
+     * // reserve0 => {"contract": "eosio.token", "weight": 500000, "balance": "55988.4608 EOS"}
+     * ```
+     */
+    struct snapshot {
+        static constexpr uint8_t MAX_RESERVES = 8;
+
+        name                        code;
+        uint64_t                    fee = 0;
+        uint8_t                     size = 0;
+        symbol_code                 symbols[MAX_RESERVES];
+        bancor::legacy::reserve     reserves[MAX_RESERVES];
+
+        const bancor::legacy::reserve* find( const symbol_code reserve ) const
+        {
+            for ( uint8_t i = 0; i < size; ++i ) {
+                if ( symbols[i] == reserve ) return &reserves[i];
+            }
+            return nullptr;
+        }
+
+        const bancor::legacy::reserve& get( const symbol_code reserve ) const
+        {
+            const bancor::legacy::reserve* res = find( reserve );
+            check( res != nullptr, "sx.bancor::legacy: reserve contract does not exist");
+            return *res;
+        }
+
+        const bancor::legacy::reserve* begin() const { return reserves; }
+        const bancor::legacy::reserve* end() const { return reserves + size; }
+    };
+
+    /**
+     * ## STATIC `load`
+     *
+     * Load a converter into a `snapshot`
+     *
+     * Reads `settings` once, walks `reserves` once and opens each token contract `accounts` table once
+     * (reserves sharing a token contract share the lookup).
+     *
+     * ### params
+     *
+     * - `{name} code` - converter contract account (ex: "bnt2eoscnvrt"_n)
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::legacy::snapshot converter = bancor::legacy::load( "bnt2eoscnvrt"_n );
+     * // converter.fee => 2000
+     * // converter.size => 2
+     * ```
+     */
+    static bancor::legacy::snapshot load( const name code )
+    {
+        bancor::legacy::settings _settings( code, code.value );
+        bancor::legacy::reserves _reserves( code, code.value );
+        check( _settings.exists(), "sx.bancor::legacy: settings does not exists");
+
+        bancor::legacy::snapshot res;
+        res.code = code;
+        res.fee = _settings.get().fee;
+
+        for ( const auto& row : _reserves ) {
+            const uint8_t i = res.size++;
+            check( res.size <= bancor::legacy::snapshot::MAX_RESERVES, "sx.bancor::legacy: too many reserves");
+            res.symbols[i] = row.currency.symbol.code();
+            res.reserves[i] = bancor::legacy::reserve{ row.contract, row.ratio, row.currency };
+        }
+
+        // balances, one `accounts` table per token contract
+        bool loaded[bancor::legacy::snapshot::MAX_RESERVES] = {};
+        for ( uint8_t i = 0; i < res.size; ++i ) {
+            if ( loaded[i] ) continue;
+            bancor::legacy::accounts _accounts( res.reserves[i].contract, code.value );
+            for ( uint8_t j = i; j < res.size; ++j ) {
+                if ( loaded[j] || res.reserves[j].contract != res.reserves[i].contract ) continue;
+                res.reserves[j].balance = _accounts.get( res.symbols[j].raw(), "no balance with specified symbol" ).balance;
+                loaded[j] = true;
+            }
+        }
+        return res;
+    }
+
+    /**
+     * ## STATIC `get_hop`
+     *
+     * Convert a reserve pair of a snapshot into a `bancor::hop` (for `bancor::route`)
+     *
+     * ### params
+     *
+     * - `{snapshot} converter` - loaded converter
+     * - `{symbol_code} reserve_in` - reserve input symbol code (ex: "EOS")
+     * - `{symbol_code} reserve_out` - reserve output symbol code (ex: "BNT")
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::legacy::snapshot converter = bancor::legacy::load( "bnt2eoscnvrt"_n );
+     * const bancor::route path = { bancor::legacy::get_hop( converter, {"EOS"}, {"BNT"} ) };
+     * ```
+     */
+    static bancor::hop get_hop( const bancor::legacy::snapshot& converter, const symbol_code reserve_in, const symbol_code reserve_out )
+    {
+        const bancor::legacy::reserve& in = converter.get( reserve_in );
+        const bancor::legacy::reserve& out = converter.get( reserve_out );
+        check( in.balance.amount >= 0 && out.balance.amount >= 0, "sx.bancor::legacy: invalid reserve balance");
+
+        return bancor::hop{ static_cast<uint64_t>(in.balance.amount), in.weight, static_cast<uint64_t>(out.balance.amount), out.weight, converter.fee };
+    }
+
+    /**
+     * ## STATIC `get_amount_out`
+     *
+     * Given an input amount and a loaded converter, returns the output amount of the other reserve
+     *
+     * ### params
+     *
+     * - `{snapshot} converter` - loaded converter
+     * - `{symbol_code} reserve_in` - reserve input symbol code (ex: "EOS")
+     * - `{symbol_code} reserve_out` - reserve output symbol code (ex: "BNT")
+     * - `{uint64_t} amount_in` - amount input
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::legacy::snapshot converter = bancor::legacy::load( "bnt2eoscnvrt"_n );
+     * const uint64_t out = bancor::legacy::get_amount_out( converter, {"EOS"}, {"BNT"}, 10000 );
+     * ```
+     */
+    static uint64_t get_amount_out( const bancor::legacy::snapshot& converter, const symbol_code reserve_in, const symbol_code reserve_out, const uint64_t amount_in )
+    {
+        const bancor::hop pair = bancor::legacy::get_hop( converter, reserve_in, reserve_out );
+        return bancor::get_amount_out( amount_in, pair.reserve_in, pair.reserve_weight_in, pair.reserve_out, pair.reserve_weight_out, pair.fee );
+    }
+
+    /**
+     * ## STATIC `get_amount_in`
+     *
+     * Given an output amount and a loaded converter, returns the required input amount of the other reserve
+     *
+     * ### params
+     *
+     * - `{snapshot} converter` - loaded converter
+     * - `{symbol_code} reserve_in` - reserve input symbol code (ex: "EOS")
+     * - `{symbol_code} reserve_out` - reserve output symbol code (ex: "BNT")
+     * - `{uint64_t} amount_out` - amount output
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::legacy::snapshot converter = bancor::legacy::load( "bnt2eoscnvrt"_n );
+     * const uint64_t in = bancor::legacy::get_amount_in( converter, {"EOS"}, {"BNT"}, 10000 );
+     * ```
+     */
+    static uint64_t get_amount_in( const bancor::legacy::snapshot& converter, const symbol_code reserve_in, const symbol_code reserve_out, const uint64_t amount_out )
+    {
+        const bancor::hop pair = bancor::legacy::get_hop( converter, reserve_in, reserve_out );
+        return bancor::get_amount_in( amount_out, pair.reserve_in, pair.reserve_weight_in, pair.reserve_out, pair.reserve_weight_out, pair.fee );
+    }
+
     /**
      * ## STATIC `get_fee`
      *
@@ -175,7 +380,7 @@ namespace legacy {
     /**
      * ## STATIC `get_reserves`
      *
-     * Get all reserves from a converter contract
+     * Get all reserves from a converter contract (no `settings` required, any number of reserves; use `load` to also keep the fee)
      *
      * ### params
      *
@@ -184,18 +389,19 @@ namespace legacy {
      * ### example
      *
      * ```c++
-     * const auto [ reserve0, reserve1 ]  = bancor::legacy::get_reserves( "bnt2eoscnvrt"_n );
-     * // reserve0 => {"contract": "eosio.token", "weight": 500000, "balance": "55988.4608 EOS"}
-     * // reserve1 => {"contract": "bntbntbntbnt", "weight": 500000, "balance": "216452.6259891919 BNT"}
+     * const auto reserves = bancor::legacy::get_reserves( "bnt2eoscnvrt"_n );
+     * // reserves[0] => {"contract": "eosio.token", "weight": 500000, "balance": "55988.4608 EOS"}
+     * // reserves[1] => {"contract": "bntbntbntbnt", "weight": 500000, "balance": "216452.6259891919 BNT"}
      * ```
      */
     static vector<bancor::legacy::reserve> get_reserves( const name code )
     {
         bancor::legacy::reserves _reserves( code, code.value );
-        std::vector<bancor::legacy::reserve> reserves;
+        vector<bancor::legacy::reserve> reserves;
 
-        for ( const auto row : _reserves ) {
-            reserves.push_back( bancor::legacy::get_reserve( code, row.currency.symbol.code() ) );
+        for ( const auto& row : _reserves ) {
+            const asset balance = eosio::token::get_balance( row.contract, code, row.currency.symbol.code() );
+            reserves.push_back( bancor::legacy::reserve{ row.contract, row.ratio, balance } );
         }
         return reserves;
     }
@@ -4,6 +4,8 @@
 #include <eosio/asset.hpp>
 #include <eosio/singleton.hpp>
 
+#include "bancor.route.hpp"
+
 namespace bancor {
 
 using eosio::name;
@@ -126,6 +128,361 @@ namespace multi {
     };
     typedef eosio::multi_index< "converter.v2"_n, converter_row > converter;
 
+    /**
+     * ## STRUCT `snapshot`
+     *
+     * Flat copy of one `converter` row (fee, reserve contracts, weights & balances), loaded with a single table read
+     *
+     * Reserves are ordered by symbol code (same order as the row maps); accessors return references into the snapshot.
+     *
+     * ### params
+     *
+     * - `{symbol} currency` - symbol of the smart token
+     * - `{uint64_t} fee` - conversion fee for this converter
+     * - `{uint8_t} size` - number of reserves (`<= MAX_RESERVES`)
+     * - `{symbol_code[]} symbols` - reserve symbol codes
+     * - `{reserve[]} reserves` - reserve contract, weight & balance
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::multi::snapshot converter = bancor::multi::load( {"EOSBNT"} );
+     * const bancor::multi::reserve& reserve0 = converter.get( {"EOS"} );
+     * // reserve0 => {"contract": "eosio.token", "weight": 500000, "balance": "57988.4155 EOS"}
+     * ```
+     */
+    struct snapshot {
+        static constexpr uint8_t MAX_RESERVES = 8;
+
+        symbol                      currency;
+        uint64_t                    fee = 0;
+        uint8_t                     size = 0;
+        symbol_code                 symbols[MAX_RESERVES];
+        bancor::multi::reserve      reserves[MAX_RESERVES];
+
+        const bancor::multi::reserve* find( const symbol_code reserve ) const
+        {
+            for ( uint8_t i = 0; i < size; ++i ) {
+                if ( symbols[i] == reserve ) return &reserves[i];
+            }
+            return nullptr;
+        }
+
+        const bancor::multi::reserve& get( const symbol_code reserve ) const
+        {
+            const bancor::multi::reserve* res = find( reserve );
+            check( res != nullptr, "sx.bancor::multi: reserve balance symbol does not exist");
+            return *res;
+        }
+
+        const bancor::multi::reserve* begin() const { return reserves; }
+        const bancor::multi::reserve* end() const { return reserves + size; }
+    };
+
+    /**
+     * ## STRUCT `flat_row`
+     *
+     * Allocation-free copy of a `converter` row: the `snapshot` the table readers build, plus the row owner
+     *
+     * Decoded straight from the ABI binary, no maps & no strings: `protocol_features` & `metadata_json` are skipped
+     * (`extended` flags a row that has any), load them on demand with `get_extras`; `to_row( flat, extras )` restores the full row.
+     *
+     * ### params
+     *
+     * - `{snapshot} snapshot` - currency, fee & reserves (ordered by symbol code)
+     * - `{name} owner` - creator of the converter
+     * - `{bool} extended` - protocol features or metadata present in the row
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::multi::converter_flat _converter( bancor::multi::code, bancor::multi::code.value );
+     * const bancor::multi::flat_row& row = _converter.get( symbol_code{"EOSBNT"}.raw() );
+     * // row.snapshot.get( {"EOS"} ) => {"contract": "eosio.token", "weight": 500000, "balance": "57988.4155 EOS"}
+     * ```
+     */
+    struct flat_row {
+        bancor::multi::snapshot         snapshot;
+        name                            owner;
+        bool                            extended = false;
+
+        uint64_t primary_key() const { return snapshot.currency.code().raw(); }
+
+        // ABI binary (`converter.v2` layout): both reserve maps merged in place, optional maps skipped
+        template <typename DataStream>
+        friend DataStream& operator>>( DataStream& ds, flat_row& row )
+        {
+            const auto read = [&]( void* data, const size_t size ) { ds.read( static_cast<char*>( data ), size ); };
+            const auto read_size = [&]() {
+                uint32_t res = 0;
+                for ( uint8_t shift = 0; ; shift += 7 ) {
+                    check( shift < 35, "sx.bancor::multi: invalid varuint32");
+                    uint8_t byte;
+                    read( &byte, 1 );
+                    res |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                    if ( !(byte & 0x80) ) return res;
+                }
+            };
+            bancor::multi::snapshot& res = row.snapshot;
+            uint64_t raw;
+            read( &raw, 8 ); res.currency = symbol( raw );
+            read( &raw, 8 ); row.owner = name( raw );
+            read( &res.fee, 8 );
+
+            const uint32_t size = read_size();
+            check( size <= bancor::multi::snapshot::MAX_RESERVES, "sx.bancor::multi: too many reserves");
+            res.size = size;
+            for ( uint8_t i = 0; i < res.size; ++i ) {
+                read( &raw, 8 ); res.symbols[i] = symbol_code( raw );
+                read( &res.reserves[i].weight, 8 );
+            }
+            check( read_size() == res.size, "sx.bancor::multi: reserve weights symbol does not exist");
+            for ( uint8_t i = 0; i < res.size; ++i ) {
+                bancor::multi::reserve& reserve = res.reserves[i];
+                read( &raw, 8 );
+                check( symbol_code( raw ) == res.symbols[i], "sx.bancor::multi: reserve weights symbol does not exist");
+                read( &reserve.balance.amount, 8 );
+                read( &raw, 8 ); reserve.balance.symbol = symbol( raw );
+                read( &raw, 8 ); reserve.contract = name( raw );
+            }
+
+            // protocol_features (name, bool) & metadata_json (name, string)
+            const uint32_t features = read_size();
+            ds.skip( static_cast<size_t>(features) * 9 );
+            const uint32_t metadata = read_size();
+            for ( uint32_t i = 0; i < metadata; ++i ) {
+                ds.skip( 8 );
+                ds.skip( read_size() );
+            }
+            row.extended = features || metadata;
+            return ds;
+        }
+    };
+    typedef eosio::multi_index< "converter.v2"_n, flat_row > converter_flat;
+
+    /**
+     * ## STRUCT `extras`
+     *
+     * Optional maps of a `converter` row, loaded on demand (`get_extras`)
+     */
+    struct extras {
+        map<name, bool>                     protocol_features;
+        map<name, string>                   metadata_json;
+    };
+
+    /**
+     * ## STATIC `load`
+     *
+     * Copy a `converter` row into a `snapshot` (no table read, used when iterating every converter)
+     *
+     * ### params
+     *
+     * - `{converter_row} row` - converter table row
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::multi::converter _converter( bancor::multi::code, bancor::multi::code.value );
+     * for ( const auto& row : _converter ) {
+     *     const bancor::multi::snapshot converter = bancor::multi::load( row );
+     * }
+     * ```
+     */
+    static bancor::multi::snapshot load( const bancor::multi::converter_row& row )
+    {
+        check( row.reserve_balances.size() <= bancor::multi::snapshot::MAX_RESERVES, "sx.bancor::multi: too many reserves");
+        check( row.reserve_balances.size() == row.reserve_weights.size(), "sx.bancor::multi: reserve weights symbol does not exist");
+
+        bancor::multi::snapshot res;
+        res.currency = row.currency;
+        res.fee = row.fee;
+
+        // both maps are ordered by symbol code => walk them together
+        auto weight = row.reserve_weights.begin();
+        for ( const auto& balance : row.reserve_balances ) {
+            check( weight->first == balance.first, "sx.bancor::multi: reserve weights symbol does not exist");
+            res.symbols[res.size] = balance.first;
+            res.reserves[res.size] = bancor::multi::reserve{ balance.second.contract, weight->second, balance.second.quantity };
+            res.size += 1;
+            ++weight;
+        }
+        return res;
+    }
+
+    /**
+     * ## STATIC `load`
+     *
+     * Snapshot of a `flat_row` (already decoded, no lookups)
+     *
+     * ### params
+     *
+     * - `{flat_row} row` - flat converter table row
+     */
+    static bancor::multi::snapshot load( const bancor::multi::flat_row& row )
+    {
+        return row.snapshot;
+    }
+
+    /**
+     * ## STATIC `to_flat` / `to_row`
+     *
+     * Lossless conversion between a `converter_row` and a `flat_row` (+ its `extras`)
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::multi::flat_row flat = bancor::multi::to_flat( row );
+     * const bancor::multi::converter_row copy = bancor::multi::to_row( flat, { row.protocol_features, row.metadata_json } );
+     * ```
+     */
+    static bancor::multi::flat_row to_flat( const bancor::multi::converter_row& row )
+    {
+        bancor::multi::flat_row res;
+        res.snapshot = bancor::multi::load( row );
+        res.owner = row.owner;
+        res.extended = !row.protocol_features.empty() || !row.metadata_json.empty();
+        return res;
+    }
+
+    static bancor::multi::converter_row to_row( const bancor::multi::flat_row& flat, const bancor::multi::extras& extras = {} )
+    {
+        const bancor::multi::snapshot& converter = flat.snapshot;
+        bancor::multi::converter_row res;
+        res.currency = converter.currency;
+        res.owner = flat.owner;
+        res.fee = converter.fee;
+        for ( uint8_t i = 0; i < converter.size; ++i ) {
+            const bancor::multi::reserve& reserve = converter.reserves[i];
+            res.reserve_weights.emplace_hint( res.reserve_weights.end(), converter.symbols[i], reserve.weight );
+            res.reserve_balances.emplace_hint( res.reserve_balances.end(), converter.symbols[i], extended_asset( reserve.balance, reserve.contract ) );
+        }
+        res.protocol_features = extras.protocol_features;
+        res.metadata_json = extras.metadata_json;
+        return res;
+    }
+
+    /**
+     * ## STATIC `get_extras`
+     *
+     * Load the optional maps of a converter (full row read, only when `flat_row::extended` matters)
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::multi::extras extras = bancor::multi::get_extras( {"EOSBNT"} );
+     * // extras.metadata_json => {}
+     * ```
+     */
+    static bancor::multi::extras get_extras( const symbol_code currency, const name code = bancor::multi::code )
+    {
+        bancor::multi::converter _converter( code, code.value );
+        const bancor::multi::converter_row& row = _converter.get( currency.raw(), "sx.bancor::multi: currency symbol does not exist");
+        return bancor::multi::extras{ row.protocol_features, row.metadata_json };
+    }
+
+    /**
+     * ## STATIC `load`
+     *
+     * Load a converter into a `snapshot` (one table read)
+     *
+     * ### params
+     *
+     * - `{symbol_code} currency` - currency symbol code (ex: "EOSBNT")
+     * - `{name} [code="bancorcnvrtr"_n]` - converter contract account
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::multi::snapshot converter = bancor::multi::load( {"EOSBNT"} );
+     * // converter.fee => 2000
+     * // converter.size => 2
+     * ```
+     */
+    static bancor::multi::snapshot load( const symbol_code currency, const name code = bancor::multi::code )
+    {
+        bancor::multi::converter_flat _converter( code, code.value );
+        return bancor::multi::load( _converter.get( currency.raw(), "sx.bancor::multi: currency symbol does not exist") );
+    }
+
+    /**
+     * ## STATIC `get_hop`
+     *
+     * Convert a reserve pair of a snapshot into a `bancor::hop` (for `bancor::route`)
+     *
+     * ### params
+     *
+     * - `{snapshot} converter` - loaded converter
+     * - `{symbol_code} reserve_in` - reserve input symbol code (ex: "EOS")
+     * - `{symbol_code} reserve_out` - reserve output symbol code (ex: "BNT")
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::multi::snapshot eosbnt = bancor::multi::load( {"EOSBNT"} );
+     * const bancor::multi::snapshot usdtbnt = bancor::multi::load( {"USDTBNT"} );
+     *
+     * const bancor::route path = { bancor::multi::get_hop( eosbnt, {"EOS"}, {"BNT"} ), bancor::multi::get_hop( usdtbnt, {"BNT"}, {"USDT"} ) };
+     * ```
+     */
+    static bancor::hop get_hop( const bancor::multi::snapshot& converter, const symbol_code reserve_in, const symbol_code reserve_out )
+    {
+        const bancor::multi::reserve& in = converter.get( reserve_in );
+        const bancor::multi::reserve& out = converter.get( reserve_out );
+        check( in.balance.amount >= 0 && out.balance.amount >= 0, "sx.bancor::multi: invalid reserve balance");
+
+        return bancor::hop{ static_cast<uint64_t>(in.balance.amount), in.weight, static_cast<uint64_t>(out.balance.amount), out.weight, converter.fee };
+    }
+
+    /**
+     * ## STATIC `get_amount_out`
+     *
+     * Given an input amount and a loaded converter, returns the output amount of the other reserve
+     *
+     * ### params
+     *
+     * - `{snapshot} converter` - loaded converter
+     * - `{symbol_code} reserve_in` - reserve input symbol code (ex: "EOS")
+     * - `{symbol_code} reserve_out` - reserve output symbol code (ex: "BNT")
+     * - `{uint64_t} amount_in` - amount input
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::multi::snapshot converter = bancor::multi::load( {"EOSBNT"} );
+     * const uint64_t out = bancor::multi::get_amount_out( converter, {"EOS"}, {"BNT"}, 10000 );
+     * ```
+     */
+    static uint64_t get_amount_out( const bancor::multi::snapshot& converter, const symbol_code reserve_in, const symbol_code reserve_out, const uint64_t amount_in )
+    {
+        const bancor::hop pair = bancor::multi::get_hop( converter, reserve_in, reserve_out );
+        return bancor::get_amount_out( amount_in, pair.reserve_in, pair.reserve_weight_in, pair.reserve_out, pair.reserve_weight_out, pair.fee );
+    }
+
+    /**
+     * ## STATIC `get_amount_in`
+     *
+     * Given an output amount and a loaded converter, returns the required input amount of the other reserve
+     *
+     * ### params
+     *
+     * - `{snapshot} converter` - loaded converter
+     * - `{symbol_code} reserve_in` - reserve input symbol code (ex: "EOS")
+     * - `{symbol_code} reserve_out` - reserve output symbol code (ex: "BNT")
+     * - `{uint64_t} amount_out` - amount output
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::multi::snapshot converter = bancor::multi::load( {"EOSBNT"} );
+     * const uint64_t in = bancor::multi::get_amount_in( converter, {"EOS"}, {"BNT"}, 37177074374 );
+     * ```
+     */
+    static uint64_t get_amount_in( const bancor::multi::snapshot& converter, const symbol_code reserve_in, const symbol_code reserve_out, const uint64_t amount_out )
+    {
+        const bancor::hop pair = bancor::multi::get_hop( converter, reserve_in, reserve_out );
+        return bancor::get_amount_in( amount_out, pair.reserve_in, pair.reserve_weight_in, pair.reserve_out, pair.reserve_weight_out, pair.fee );
+    }
+
     /**
      * ## STATIC `get_fee`
      *
@@ -172,18 +529,18 @@ namespace multi {
     static bancor::multi::reserve get_reserve( const symbol_code currency, const symbol_code reserve, const name code = bancor::multi::code )
     {
         bancor::multi::converter _converter( code, code.value );
-        auto row = _converter.get( currency.raw(), "sx.bancor::multi: currency symbol does not exist");
-        check(row.reserve_balances.count(reserve), "sx.bancor::multi: reserve balance symbol does not exist");
-        check(row.reserve_weights.count(reserve), "sx.bancor::multi: reserve weights symbol does not exist");
-
-        const extended_asset balance = row.reserve_balances.at(reserve);
-        return bancor::multi::reserve{ balance.contract, row.reserve_weights.at(reserve), balance.quantity };
+        const bancor::multi::converter_row& row = _converter.get( currency.raw(), "sx.bancor::multi: currency symbol does not exist");
+        const auto balance = row.reserve_balances.find( reserve );
+        const auto weight = row.reserve_weights.find( reserve );
+        check( balance != row.reserve_balances.end(), "sx.bancor::multi: reserve balance symbol does not exist");
+        check( weight != row.reserve_weights.end(), "sx.bancor::multi: reserve weights symbol does not exist");
+        return bancor::multi::reserve{ balance->second.contract, weight->second, balance->second.quantity };
     }
 
     /**
      * ## STATIC `get_reserves`
      *
-     * Get all reserves from a currency
+     * Get all reserves from a currency (one table read, any number of reserves; use `load` to also keep the fee)
      *
      * ### params
      *
@@ -193,19 +550,24 @@ namespace multi {
      * ### example
      *
      * ```c++
-     * const auto [ reserve0, reserve1 ] = bancor::multi::get_reserves( {"EOSBNT"} );
-     * // reserve0 => {"contract": "eosio.token", "weight": 500000, "balance": "58671.7133 EOS"}
-     * // reserve1 => {"contract": "bntbntbntbnt", "weight": 500000, "balance": "213956.7397575675 BNT"}
+     * const auto reserves = bancor::multi::get_reserves( {"EOSBNT"} );
+     * // reserves[0] => {"contract": "eosio.token", "weight": 500000, "balance": "58671.7133 EOS"}
+     * // reserves[1] => {"contract": "bntbntbntbnt", "weight": 500000, "balance": "213956.7397575675 BNT"}
      * ```
      */
     static std::vector<bancor::multi::reserve> get_reserves( const symbol_code currency, const name code = bancor::multi::code )
     {
         bancor::multi::converter _converter( code, code.value );
-        std::vector<bancor::multi::reserve> reserves;
+        const bancor::multi::converter_row& row = _converter.get( currency.raw(), "sx.bancor::multi: currency symbol does not exist");
+        check( row.reserve_balances.size() == row.reserve_weights.size(), "sx.bancor::multi: reserve weights symbol does not exist");
 
-        auto row = _converter.get( currency.raw(), "sx.bancor::multi: currency symbol does not exist");
-        for ( const auto itr : row.reserve_balances ) {
-            reserves.push_back( bancor::multi::get_reserve( currency, itr.first, code ) );
+        // both maps are ordered by symbol code => walk them together
+        std::vector<bancor::multi::reserve> reserves;
+        auto weight = row.reserve_weights.begin();
+        for ( const auto& balance : row.reserve_balances ) {
+            check( weight->first == balance.first, "sx.bancor::multi: reserve weights symbol does not exist");
+            reserves.push_back( bancor::multi::reserve{ balance.second.contract, weight->second, balance.second.quantity } );
+            ++weight;
         }
         return reserves;
     }
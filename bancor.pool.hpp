@@ -0,0 +1,313 @@
+#pragma once
+
+#include "bancor.hpp"
+#include "bancor.multi.hpp"
+
+namespace bancor {
+
+    /**
+     * ## STRUCT `pool`
+     *
+     * N-reserve converter with its constants computed once: balances, weights, fee factor, total weight
+     * and the `formula::curve` of every reserve pair (no table read, no symbol lookup per quote)
+     *
+     * ### params
+     *
+     * - `{symbol} currency` - symbol of the smart token
+     * - `{uint64_t} fee` - conversion fee (pips 1/10000 of 1%)
+     * - `{uint64_t} fee_factor` - `(MAX_FEE - fee)^2`
+     * - `{uint64_t} total_weight` - sum of the reserve weights
+     * - `{uint8_t} size` - number of reserves (`<= MAX_RESERVES`)
+     * - `{symbol_code[]} symbols` - reserve symbol codes (snapshot order)
+     * - `{name[]} contracts` - reserve token contracts
+     * - `{uint64_t[]} balances` - reserve balances
+     * - `{uint64_t[]} weights` - reserve weights
+     * - `{curve[][]} curves` - kernel of every `[in][out]` reserve pair
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::pool pool = bancor::get_pool( bancor::multi::load( {"EOSBNT"} ) );
+     * // pool.size => 2
+     * // pool.index( {"BNT"} ) => 1
+     * ```
+     */
+    struct pool {
+        static constexpr uint8_t MAX_RESERVES = bancor::multi::snapshot::MAX_RESERVES;
+
+        symbol              currency;
+        uint64_t            fee = 0;
+        uint64_t            fee_factor = 0;
+        uint64_t            total_weight = 0;
+        uint8_t             size = 0;
+        symbol_code         symbols[MAX_RESERVES];
+        name                contracts[MAX_RESERVES];
+        uint64_t            balances[MAX_RESERVES];
+        uint64_t            weights[MAX_RESERVES];
+        formula::curve      curves[MAX_RESERVES][MAX_RESERVES];
+
+        int8_t find( const symbol_code reserve ) const
+        {
+            for ( uint8_t i = 0; i < size; ++i ) {
+                if ( symbols[i] == reserve ) return i;
+            }
+            return -1;
+        }
+
+        uint8_t index( const symbol_code reserve ) const
+        {
+            const int8_t res = find( reserve );
+            check( res >= 0, "sx.bancor::multi: reserve balance symbol does not exist");
+            return res;
+        }
+    };
+
+    /**
+     * ## STATIC `get_pool`
+     *
+     * Build a `pool` from a loaded multi converter (weights, fee & pair curves validated and classified once)
+     *
+     * ### params
+     *
+     * - `{snapshot} converter` - loaded converter
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::pool pool = bancor::get_pool( bancor::multi::load( {"EOSBNT"} ) );
+     * ```
+     */
+    static bancor::pool get_pool( const bancor::multi::snapshot& converter )
+    {
+        check( converter.fee <= formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+        bancor::pool res;
+        res.currency = converter.currency;
+        res.fee = converter.fee;
+        res.fee_factor = (formula::MAX_FEE - converter.fee) * (formula::MAX_FEE - converter.fee);
+        res.size = converter.size;
+        for ( uint8_t i = 0; i < converter.size; ++i ) {
+            const bancor::multi::reserve& reserve = converter.reserves[i];
+            check( reserve.balance.amount >= 0, "sx.bancor::multi: invalid reserve balance");
+            check( reserve.weight > 0 && reserve.weight <= formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+
+            res.symbols[i] = converter.symbols[i];
+            res.contracts[i] = reserve.contract;
+            res.balances[i] = static_cast<uint64_t>(reserve.balance.amount);
+            res.weights[i] = reserve.weight;
+            res.total_weight += reserve.weight;
+        }
+        for ( uint8_t i = 0; i < res.size; ++i ) {
+            for ( uint8_t j = 0; j < res.size; ++j ) res.curves[i][j] = formula::get_curve( res.weights[i], res.weights[j] );
+        }
+        return res;
+    }
+
+    /**
+     * ## STATIC `get_amount_out`
+     *
+     * Given an input amount and a pool, returns the output amount of any other reserve (same result as `bancor::get_amount_out`)
+     *
+     * ### params
+     *
+     * - `{pool} pool` - N-reserve converter
+     * - `{uint8_t} in` - reserve input index (`pool.index( symbol_code )`)
+     * - `{uint8_t} out` - reserve output index
+     * - `{uint64_t} amount_in` - amount input
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t out = bancor::get_amount_out( pool, pool.index( {"EOS"} ), pool.index( {"BNT"} ), 10000 );
+     * // => 37177074374
+     * ```
+     */
+    static uint64_t get_amount_out( const bancor::pool& pool, const uint8_t in, const uint8_t out, const uint64_t amount_in )
+    {
+        // checks
+        eosio::check(in < pool.size && out < pool.size && in != out, "sx.bancor: INVALID_RESERVE");
+        eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(pool.balances[in] > 0 && pool.balances[out] > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+
+        // calculations
+        const uint128_t ratio = formula::target_ratio( pool.curves[in][out], amount_in, pool.balances[in], pool.weights[in], pool.weights[out] );
+        const uint64_t ratio_after_fee = safemath::mul_div( static_cast<uint64_t>(ratio), pool.fee_factor, formula::MAX_FEE * formula::MAX_FEE );
+        return static_cast<uint64_t>(safemath::mul( ratio_after_fee, pool.balances[out] ) >> 64);
+    }
+
+    /**
+     * ## STATIC `get_amounts_out`
+     *
+     * Given an input amount and a pool, returns the output amount of every other reserve in O(N)
+     *
+     * The logarithm of the input side is shared by every general-weight output (one `general_log`, one `optimal_exp` per output);
+     * every entry equals `get_amount_out( pool, in, j, amount_in )` and `amounts_out[in]` is 0.
+     *
+     * ### params
+     *
+     * - `{pool} pool` - N-reserve converter
+     * - `{uint8_t} in` - reserve input index
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t*} amounts_out` - [out] output amount per reserve (`pool.size` entries)
+     *
+     * ### example
+     *
+     * ```c++
+     * uint64_t amounts_out[bancor::pool::MAX_RESERVES];
+     * bancor::get_amounts_out( pool, pool.index( {"EOS"} ), 10000, amounts_out );
+     * ```
+     */
+    static void get_amounts_out( const bancor::pool& pool, const uint8_t in, const uint64_t amount_in, uint64_t* amounts_out )
+    {
+        // checks
+        eosio::check(in < pool.size, "sx.bancor: INVALID_RESERVE");
+        eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(pool.balances[in] > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+
+        // ln((reserve_in + amount_in) / reserve_in), computed on first use
+        uint128_t log = 0;
+        bool has_log = false;
+
+        for ( uint8_t out = 0; out < pool.size; ++out ) {
+            amounts_out[out] = 0;
+            if ( out == in ) continue;
+            eosio::check(pool.balances[out] > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+
+            uint128_t ratio;
+            if ( pool.curves[in][out] == formula::curve::general ) {
+                if ( !has_log ) {
+                    log = formula::general_log( static_cast<uint128_t>(pool.balances[in]) + amount_in, pool.balances[in] );
+                    has_log = true;
+                }
+                const uint128_t power = formula::optimal_exp( log * pool.weights[in] / pool.weights[out] );
+                ratio = 0;
+                if ( power < formula::fixed_1() ) ratio = formula::fixed_1() - power;
+            } else {
+                ratio = formula::target_ratio( pool.curves[in][out], amount_in, pool.balances[in], pool.weights[in], pool.weights[out] );
+            }
+            const uint64_t ratio_after_fee = safemath::mul_div( static_cast<uint64_t>(ratio), pool.fee_factor, formula::MAX_FEE * formula::MAX_FEE );
+            amounts_out[out] = static_cast<uint64_t>(safemath::mul( ratio_after_fee, pool.balances[out] ) >> 64);
+        }
+    }
+
+    /**
+     * ## STATIC `get_amount_in`
+     *
+     * Given an output amount and a pool, returns the required input amount of any other reserve
+     *
+     * ### params
+     *
+     * - `{pool} pool` - N-reserve converter
+     * - `{uint8_t} in` - reserve input index
+     * - `{uint8_t} out` - reserve output index
+     * - `{uint64_t} amount_out` - amount output
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t in = bancor::get_amount_in( pool, pool.index( {"EOS"} ), pool.index( {"BNT"} ), 37177074374 );
+     * // => 10000
+     * ```
+     */
+    static uint64_t get_amount_in( const bancor::pool& pool, const uint8_t in, const uint8_t out, const uint64_t amount_out )
+    {
+        eosio::check(in < pool.size && out < pool.size && in != out, "sx.bancor: INVALID_RESERVE");
+        return bancor::get_amount_in( amount_out, pool.balances[in], pool.weights[in], pool.balances[out], pool.weights[out], pool.fee );
+    }
+
+    /**
+     * ## STATIC `get_deposit_return`
+     *
+     * Single-sided deposit: given a reserve amount, returns the smart tokens issued (`purchase_return`, fee applied once)
+     *
+     * ### params
+     *
+     * - `{pool} pool` - N-reserve converter
+     * - `{uint64_t} supply` - smart token supply
+     * - `{uint8_t} in` - reserve index
+     * - `{uint64_t} amount` - reserve amount deposited
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t tokens = bancor::get_deposit_return( pool, 1000000000, pool.index( {"EOS"} ), 10000000 );
+     * ```
+     */
+    static uint64_t get_deposit_return( const bancor::pool& pool, const uint64_t supply, const uint8_t in, const uint64_t amount )
+    {
+        eosio::check(in < pool.size, "sx.bancor: INVALID_RESERVE");
+        return bancor::purchase_return( supply, pool.balances[in], pool.weights[in], amount, pool.fee );
+    }
+
+    /**
+     * ## STATIC `get_withdraw_return`
+     *
+     * Single-sided withdrawal: given smart tokens, returns the amount of one reserve received (`sale_return`, fee applied once)
+     *
+     * ### params
+     *
+     * - `{pool} pool` - N-reserve converter
+     * - `{uint64_t} supply` - smart token supply
+     * - `{uint8_t} out` - reserve index
+     * - `{uint64_t} amount` - smart tokens sold
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t eos = bancor::get_withdraw_return( pool, 1000000000, pool.index( {"EOS"} ), 10000000 );
+     * ```
+     */
+    static uint64_t get_withdraw_return( const bancor::pool& pool, const uint64_t supply, const uint8_t out, const uint64_t amount )
+    {
+        eosio::check(out < pool.size, "sx.bancor: INVALID_RESERVE");
+        return bancor::sale_return( supply, pool.balances[out], pool.weights[out], amount, pool.fee );
+    }
+
+    /**
+     * ## STATIC `get_fund_costs`
+     *
+     * Proportional deposit: given smart tokens to issue, returns the amount required of every reserve (`fund_cost` with the total weight, rounded up)
+     *
+     * ### params
+     *
+     * - `{pool} pool` - N-reserve converter
+     * - `{uint64_t} supply` - smart token supply
+     * - `{uint64_t} amount` - smart tokens issued
+     * - `{uint64_t*} costs` - [out] reserve amount per reserve (`pool.size` entries)
+     *
+     * ### example
+     *
+     * ```c++
+     * uint64_t costs[bancor::pool::MAX_RESERVES];
+     * bancor::get_fund_costs( pool, 1000000000, 10000000, costs );
+     * ```
+     */
+    static void get_fund_costs( const bancor::pool& pool, const uint64_t supply, const uint64_t amount, uint64_t* costs )
+    {
+        for ( uint8_t i = 0; i < pool.size; ++i ) costs[i] = bancor::fund_cost( supply, pool.balances[i], pool.total_weight, amount );
+    }
+
+    /**
+     * ## STATIC `get_liquidate_returns`
+     *
+     * Proportional withdrawal: given smart tokens to liquidate, returns the amount received of every reserve (`liquidate_return` with the total weight)
+     *
+     * ### params
+     *
+     * - `{pool} pool` - N-reserve converter
+     * - `{uint64_t} supply` - smart token supply
+     * - `{uint64_t} amount` - smart tokens liquidated
+     * - `{uint64_t*} returns` - [out] reserve amount per reserve (`pool.size` entries)
+     *
+     * ### example
+     *
+     * ```c++
+     * uint64_t returns[bancor::pool::MAX_RESERVES];
+     * bancor::get_liquidate_returns( pool, 1000000000, 10000000, returns );
+     * ```
+     */
+    static void get_liquidate_returns( const bancor::pool& pool, const uint64_t supply, const uint64_t amount, uint64_t* returns )
+    {
+        for ( uint8_t i = 0; i < pool.size; ++i ) returns[i] = bancor::liquidate_return( supply, pool.balances[i], pool.total_weight, amount );
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <initializer_list>
+
+#include "bancor.hpp"
+
+namespace bancor {
+
+    /**
+     * ## STRUCT `hop`
+     *
+     * One converter of a `bancor::route` (same inputs as `get_amount_out`, minus the amount)
+     *
+     * ### params
+     *
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint64_t} fee` - trading fee (pips 1/10000 of 1%)
+     */
+    struct hop {
+        uint64_t    reserve_in;
+        uint64_t    reserve_weight_in;
+        uint64_t    reserve_out;
+        uint64_t    reserve_weight_out;
+        uint64_t    fee;
+    };
+
+    /**
+     * ## STRUCT `route`
+     *
+     * Fixed list of hops (output of each hop is the input of the next) with per-hop constants computed once
+     *
+     * Hops are validated when added; `get_amount_out` / `get_amount_in` only run the kernels.
+     *
+     * ### params
+     *
+     * - `{uint8_t} size` - number of hops (`<= MAX_HOPS`)
+     * - `{hop[]} hops` - converters in trade order
+     * - `{formula::curve[]} curves` - kernel selected for each hop's weights
+     * - `{uint64_t[]} fee_factors` - `(MAX_FEE - fee)^2` of each hop
+     *
+     * ### example
+     *
+     * ```c++
+     * // EOS => BNT => USDT
+     * const bancor::route path = {
+     *     { 579884155, 500000, 2164526259891919, 500000, 2000 },
+     *     { 2170087186740517, 500000, 1254361234, 500000, 2000 }
+     * };
+     * ```
+     */
+    struct route {
+        static constexpr uint8_t MAX_HOPS = 8;
+
+        uint8_t             size = 0;
+        hop                 hops[MAX_HOPS];
+        formula::curve      curves[MAX_HOPS];
+        uint64_t            fee_factors[MAX_HOPS];
+
+        route() {}
+
+        route( std::initializer_list<hop> list )
+        {
+            for ( const hop& item : list ) push_back( item );
+        }
+
+        void push_back( const hop& item )
+        {
+            // checks
+            eosio::check(size < MAX_HOPS, "sx.bancor: INVALID_ROUTE");
+            eosio::check(item.reserve_in > 0 && item.reserve_out > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+            eosio::check(item.reserve_weight_in > 0 && item.reserve_weight_out > 0, "sx.bancor: INVALID_WEIGHT");
+            eosio::check(item.reserve_weight_in <= formula::MAX_WEIGHT && item.reserve_weight_out <= formula::MAX_WEIGHT, "sx.bancor: INVALID_WEIGHT");
+            eosio::check(item.fee <= formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+            // constants
+            hops[size] = item;
+            curves[size] = formula::get_curve( item.reserve_weight_in, item.reserve_weight_out );
+            fee_factors[size] = (formula::MAX_FEE - item.fee) * (formula::MAX_FEE - item.fee);
+            size += 1;
+        }
+    };
+
+    /**
+     * ## STATIC `get_amount_out`
+     *
+     * Given an input amount and a route, returns the output amount of the last hop
+     *
+     * Intermediate amounts are carried in Q.64 (never rounded to integers); only the final output is rounded down.
+     *
+     * ### params
+     *
+     * - `{route} path` - converters in trade order
+     * - `{uint64_t} amount_in` - amount input of the first hop
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::route path = {{ 45851931234, 500000, 125682033533, 500000, 2000 }};
+     *
+     * const uint64_t out = bancor::get_amount_out( path, 10000 );
+     * // => 27300
+     * ```
+     */
+    static uint64_t get_amount_out( const bancor::route& path, const uint64_t amount_in )
+    {
+        // checks
+        eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(path.size > 0, "sx.bancor: INVALID_ROUTE");
+
+        // calculations
+        uint128_t amount = static_cast<uint128_t>(amount_in) << 64;
+        for ( uint8_t i = 0; i < path.size; ++i ) {
+            const hop& item = path.hops[i];
+            amount = formula::amount_out_q64( amount, item.reserve_in, item.reserve_weight_in, item.reserve_out, item.reserve_weight_out, path.curves[i], path.fee_factors[i] );
+        }
+        return static_cast<uint64_t>(amount >> 64);
+    }
+
+    /**
+     * ## STATIC `get_amount_in`
+     *
+     * Given an output amount of the last hop and a route, returns the required input amount of the first hop
+     *
+     * Walks the hops backwards in Q.64; only the final input is rounded up.
+     *
+     * ### params
+     *
+     * - `{route} path` - converters in trade order
+     * - `{uint64_t} amount_out` - amount output of the last hop
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::route path = {{ 45851931234, 500000, 125682033533, 500000, 2000 }};
+     *
+     * const uint64_t in = bancor::get_amount_in( path, 27300 );
+     * // => 10000
+     * ```
+     */
+    static uint64_t get_amount_in( const bancor::route& path, const uint64_t amount_out )
+    {
+        // checks
+        eosio::check(amount_out > 0, "sx.bancor: INSUFFICIENT_OUTPUT_AMOUNT");
+        eosio::check(path.size > 0, "sx.bancor: INVALID_ROUTE");
+
+        // calculations
+        uint128_t amount = static_cast<uint128_t>(amount_out) << 64;
+        for ( uint8_t i = path.size; i > 0; --i ) {
+            const hop& item = path.hops[i - 1];
+            eosio::check(path.fee_factors[i - 1] > 0, "sx.bancor: INVALID_FEE");
+            amount = formula::source_amount_q64( amount, item.reserve_in, item.reserve_weight_in, item.reserve_out, item.reserve_weight_out, path.fee_factors[i - 1] );
+            eosio::check(amount != ~static_cast<uint128_t>(0), "sx.bancor: INSUFFICIENT_LIQUIDITY");
+        }
+
+        // rounded up to an integer
+        const uint128_t amount_in = (amount >> 64) + (static_cast<uint64_t>(amount) ? 1 : 0);
+        eosio::check(amount_in <= UINT64_MAX, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+
+        return static_cast<uint64_t>(amount_in);
+    }
+}
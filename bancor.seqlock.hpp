@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "bancor.pool.hpp"
+
+/**
+ * Seqlock-protected converter state (off-chain, one writer & any number of readers)
+ *
+ * Payloads are copied word by word through relaxed atomics between two reads of a sequence number;
+ * a reader that overlaps a write sees an odd or changed sequence and copies again, so it never blocks
+ * the writer and never returns a torn converter (balances of two different updates).
+ */
+namespace bancor {
+namespace server {
+
+    /**
+     * ## STRUCT `seqlock`
+     *
+     * Single-writer sequence lock around a trivially copyable value
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::server::seqlock<bancor::pool> state;
+     * state.store( pool );                        // writer
+     * const bancor::pool current = state.load();  // readers
+     * ```
+     */
+    template <typename T>
+    struct seqlock {
+        static_assert( std::is_trivially_copyable<T>::value, "sx.bancor::server: seqlock value must be trivially copyable" );
+        static constexpr size_t WORDS = (sizeof( T ) + 7) / 8;
+
+        // writer (one thread)
+        void store( const T& value )
+        {
+            uint64_t words[WORDS] = {};
+            std::memcpy( words, &value, sizeof( T ) );
+
+            const uint64_t sequence = _sequence.load( std::memory_order_relaxed );
+            _sequence.store( sequence + 1, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+            for ( size_t i = 0; i < WORDS; ++i ) _words[i].store( words[i], std::memory_order_relaxed );
+            _sequence.store( sequence + 2, std::memory_order_release );
+        }
+
+        // one copy attempt, false when it overlapped a write
+        bool try_load( T& value ) const
+        {
+            uint64_t words[WORDS];
+            const uint64_t before = _sequence.load( std::memory_order_acquire );
+            if ( before & 1 ) return false;
+            for ( size_t i = 0; i < WORDS; ++i ) words[i] = _words[i].load( std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_acquire );
+            if ( _sequence.load( std::memory_order_relaxed ) != before ) return false;
+
+            std::memcpy( &value, words, sizeof( T ) );
+            return true;
+        }
+
+        T load() const
+        {
+            T value;
+            while ( !try_load( value ) ) {}
+            return value;
+        }
+
+        // number of completed writes
+        uint64_t version() const { return _sequence.load( std::memory_order_acquire ) / 2; }
+
+    private:
+        std::atomic<uint64_t>   _sequence{0};
+        std::atomic<uint64_t>   _words[WORDS] = {};
+    };
+
+    /**
+     * ## STRUCT `table`
+     *
+     * Converter table keyed by currency symbol code: fixed capacity, one `seqlock<pool>` per converter
+     *
+     * Slots and the open-addressing index are allocated once (never moved), keys are published after their first
+     * value, so readers look up and copy a converter without locks while the feed thread updates it.
+     *
+     * ### params
+     *
+     * - `{uint32_t} capacity` - maximum number of converters (rounded up to a power of two, twice as many index entries)
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::server::table table( 1024 );
+     * table.set( bancor::multi::load( {"EOSBNT"} ) );     // feed thread
+     *
+     * bancor::pool pool;                                   // quoting threads
+     * if ( table.get( {"EOSBNT"}, pool ) ) {
+     *     const uint64_t out = bancor::get_amount_out( pool, pool.index( {"EOS"} ), pool.index( {"BNT"} ), 10000 );
+     * }
+     * ```
+     */
+    struct table {
+        explicit table( const uint32_t capacity = 1024 )
+        {
+            while ( _mask + 1 < 2 * static_cast<uint64_t>( capacity ) ) _mask = _mask * 2 + 1;
+            _capacity = capacity;
+            _keys.reset( new std::atomic<uint64_t>[_mask + 1] );
+            _index.reset( new uint32_t[_mask + 1] );
+            _slots.reset( new seqlock<bancor::pool>[capacity] );
+            for ( uint64_t i = 0; i <= _mask; ++i ) _keys[i].store( 0, std::memory_order_relaxed );
+        }
+
+        table( const table& ) = delete;
+        table& operator=( const table& ) = delete;
+
+        // writer: insert or update a converter, false when the table is full
+        bool set( const symbol_code currency, const bancor::pool& pool )
+        {
+            const int64_t found = find( currency );
+            if ( found >= 0 ) {
+                _slots[found].store( pool );
+                return true;
+            }
+            const uint32_t size = _size.load( std::memory_order_relaxed );
+            if ( size == _capacity ) return false;
+
+            uint64_t position = hash( currency );
+            while ( _keys[position].load( std::memory_order_relaxed ) != 0 ) position = (position + 1) & _mask;
+            _slots[size].store( pool );
+            _index[position] = size;
+            _keys[position].store( currency.raw(), std::memory_order_release );
+            _size.store( size + 1, std::memory_order_release );
+            return true;
+        }
+
+        bool set( const bancor::multi::snapshot& converter )
+        {
+            return set( converter.currency.code(), bancor::get_pool( converter ) );
+        }
+
+        // reader: consistent copy of a converter, false when unknown
+        bool get( const symbol_code currency, bancor::pool& pool ) const
+        {
+            const int64_t slot = find( currency );
+            if ( slot < 0 ) return false;
+            pool = _slots[slot].load();
+            return true;
+        }
+
+        bancor::pool get( const symbol_code currency ) const
+        {
+            bancor::pool res;
+            eosio::check( get( currency, res ), "sx.bancor::server: currency symbol does not exist");
+            return res;
+        }
+
+        // number of completed updates of a converter (0 when unknown)
+        uint64_t version( const symbol_code currency ) const
+        {
+            const int64_t slot = find( currency );
+            return slot < 0 ? 0 : _slots[slot].version();
+        }
+
+        uint32_t size() const { return _size.load( std::memory_order_acquire ); }
+        uint32_t capacity() const { return _capacity; }
+
+    private:
+        uint64_t hash( const symbol_code currency ) const
+        {
+            return (currency.raw() * 0x9E3779B97F4A7C15) >> 32 & _mask;
+        }
+
+        int64_t find( const symbol_code currency ) const
+        {
+            if ( currency.raw() == 0 ) return -1;
+            for ( uint64_t position = hash( currency ); ; position = (position + 1) & _mask ) {
+                const uint64_t key = _keys[position].load( std::memory_order_acquire );
+                if ( key == currency.raw() ) return _index[position];
+                if ( key == 0 ) return -1;
+            }
+        }
+
+        uint64_t                                        _mask = 1;
+        uint32_t                                        _capacity = 0;
+        std::atomic<uint32_t>                           _size{0};
+        std::unique_ptr<std::atomic<uint64_t>[]>        _keys;
+        std::unique_ptr<uint32_t[]>                     _index;     // written before its key is published
+        std::unique_ptr<seqlock<bancor::pool>[]>        _slots;
+    };
+}
+}
@@ -0,0 +1,616 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bancor.graph.hpp"
+
+/**
+ * Off-chain quote server (POSIX only, not for contracts)
+ *
+ * Every converter is kept in memory as an immutable `book` (converter graph + version); updates copy the book,
+ * apply the new snapshots and publish it with one atomic store. Readers pin an epoch in their own slot, load the
+ * book and quote without locks; retired books are freed once no pinned reader can still see them.
+ */
+namespace bancor {
+namespace server {
+
+    /**
+     * ## STRUCT `book`
+     *
+     * Immutable converter state served to readers
+     *
+     * ### params
+     *
+     * - `{uint64_t} version` - incremented on every published update
+     * - `{graph} graph` - converters, tokens & edges
+     */
+    struct book {
+        uint64_t        version = 0;
+        bancor::graph   graph;
+    };
+
+    /**
+     * ## STRUCT `store`
+     *
+     * In-memory converter store, one writer & up to `MAX_READERS` concurrent readers
+     *
+     * Readers are wait-free: `read( slot )` pins the current epoch in `slot`, loads the book and unpins when the view
+     * goes out of scope; every quote made through one view is priced on the same version. The writer (one thread)
+     * publishes a copy of the book per `update` and frees retired books when every pinned epoch is past them.
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::server::store store;
+     * store.update( []( bancor::graph& graph ) { graph.load_multi(); } );
+     *
+     * // reader thread (own slot)
+     * const auto view = store.read( 0 );
+     * // view->version => 1
+     * // view->graph.converters.size() => 2
+     * ```
+     */
+    struct store {
+        static constexpr uint32_t MAX_READERS = 64;
+
+        // pinned book, unpinned on destruction
+        struct view {
+            view( std::atomic<uint64_t>& slot, const bancor::server::book* book ) : _slot( slot ), _book( book ) {}
+            view( const view& ) = delete;
+            view& operator=( const view& ) = delete;
+            ~view() { _slot.store( 0, std::memory_order_release ); }
+
+            const bancor::server::book& operator*() const { return *_book; }
+            const bancor::server::book* operator->() const { return _book; }
+
+        private:
+            std::atomic<uint64_t>&          _slot;
+            const bancor::server::book*     _book;
+        };
+
+        store() : _current( new book() ) {}
+        store( const store& ) = delete;
+        store& operator=( const store& ) = delete;
+        ~store()
+        {
+            delete _current.load();
+            for ( const auto& item : _retired ) delete item.second;
+        }
+
+        // reader: one slot per thread, views of one slot must not overlap
+        view read( const uint32_t slot ) const
+        {
+            eosio::check( slot < MAX_READERS, "sx.bancor::server: invalid reader slot");
+            std::atomic<uint64_t>& pin = _slots[slot].epoch;
+            pin.store( _epoch.load() );
+            return view( pin, _current.load() );
+        }
+
+        // writer: apply `fn( graph )` on a copy and publish it, returns the new version
+        template <typename F>
+        uint64_t update( F fn )
+        {
+            const book* current = _current.load( std::memory_order_relaxed );
+            std::unique_ptr<book> next( new book( *current ) );
+            fn( next->graph );
+            next->version = current->version + 1;
+            const uint64_t version = next->version;
+
+            // readers pinned before the new epoch may still hold `current`
+            _current.store( next.release() );
+            _retired.emplace_back( _epoch.fetch_add( 1 ) + 1, current );
+            reclaim();
+            return version;
+        }
+
+        uint64_t set_multi( const bancor::multi::snapshot& snapshot, const name code = bancor::multi::code )
+        {
+            return update( [&]( bancor::graph& graph ) { graph.set_multi( snapshot, code ); } );
+        }
+
+        uint64_t set_legacy( const bancor::legacy::snapshot& snapshot )
+        {
+            return update( [&]( bancor::graph& graph ) { graph.set_legacy( snapshot ); } );
+        }
+
+        uint64_t version() const { return _current.load()->version; }
+
+        // books waiting for readers (writer thread)
+        size_t retired() const { return _retired.size(); }
+
+        // free every retired book no pinned reader can reach (writer thread)
+        void reclaim()
+        {
+            uint64_t oldest = UINT64_MAX;
+            for ( const slot& item : _slots ) {
+                const uint64_t epoch = item.epoch.load();
+                if ( epoch != 0 && epoch < oldest ) oldest = epoch;
+            }
+            auto itr = std::remove_if( _retired.begin(), _retired.end(), [&]( const std::pair<uint64_t, const book*>& item ) {
+                if ( item.first > oldest ) return false;
+                delete item.second;
+                return true;
+            });
+            _retired.erase( itr, _retired.end() );
+        }
+
+    private:
+        struct alignas(64) slot {
+            std::atomic<uint64_t>   epoch{0};       // 0 when not reading
+        };
+
+        std::atomic<const book*>                        _current;
+        std::atomic<uint64_t>                           _epoch{1};
+        mutable slot                                    _slots[MAX_READERS];
+        vector<std::pair<uint64_t, const book*>>        _retired;   // (epoch, book)
+    };
+
+    // request kind & response status
+    enum class op : uint8_t {
+        amount_out = 1,
+        amount_in = 2,
+        route = 3,
+    };
+
+    enum class status : uint8_t {
+        ok = 0,
+        not_found = 1,
+        invalid = 2,
+    };
+
+    /**
+     * ## STRUCT `request`
+     *
+     * Fixed-size request frame (72 bytes, host byte order)
+     *
+     * ### params
+     *
+     * - `{uint64_t} id` - echoed in the response
+     * - `{op} kind` - `op::amount_out`, `op::amount_in` (one converter) or `op::route` (best route output)
+     * - `{uint8_t} max_hops` - route length limit (0 => 3)
+     * - `{uint64_t} code` - converter contract account (converter quotes)
+     * - `{uint64_t} currency` - multi converter currency symbol code (0 for legacy converters)
+     * - `{uint64_t} contract_in` - input token contract (routes)
+     * - `{uint64_t} symbol_in` - input symbol code
+     * - `{uint64_t} contract_out` - output token contract (routes)
+     * - `{uint64_t} symbol_out` - output symbol code
+     * - `{uint64_t} amount` - amount input (`amount_out`, `route`) or output (`amount_in`)
+     */
+    struct request {
+        uint64_t        id = 0;
+        op              kind = op::amount_out;
+        uint8_t         max_hops = 0;
+        uint8_t         padding[6] = {};
+        uint64_t        code = 0;
+        uint64_t        currency = 0;
+        uint64_t        contract_in = 0;
+        uint64_t        symbol_in = 0;
+        uint64_t        contract_out = 0;
+        uint64_t        symbol_out = 0;
+        uint64_t        amount = 0;
+    };
+
+    /**
+     * ## STRUCT `response`
+     *
+     * Fixed-size response frame (32 bytes, host byte order)
+     *
+     * ### params
+     *
+     * - `{uint64_t} id` - request id
+     * - `{uint64_t} amount` - quoted amount
+     * - `{uint64_t} version` - book version the quote was priced on
+     * - `{status} result` - `ok`, `not_found` (converter, reserve or route) or `invalid` (rejected inputs)
+     * - `{uint8_t} hops` - route length
+     */
+    struct response {
+        uint64_t        id = 0;
+        uint64_t        amount = 0;
+        uint64_t        version = 0;
+        status          result = status::ok;
+        uint8_t         hops = 0;
+        uint8_t         padding[6] = {};
+    };
+
+    static_assert( sizeof( request ) == 72, "sx.bancor::server: request frame size" );
+    static_assert( sizeof( response ) == 32, "sx.bancor::server: response frame size" );
+
+    /**
+     * ## STATIC `handle`
+     *
+     * Price one request on a book (no allocation for converter quotes, `get_routes` for routes)
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::server::request req;
+     * req.kind = bancor::server::op::amount_out;
+     * req.code = "bancorcnvrtr"_n.value;
+     * req.currency = symbol_code{"EOSBNT"}.raw();
+     * req.symbol_in = symbol_code{"EOS"}.raw();
+     * req.symbol_out = symbol_code{"BNT"}.raw();
+     * req.amount = 10000;
+     *
+     * const bancor::server::response res = bancor::server::handle( *store.read( 0 ), req );
+     * // res.amount => 37177074374
+     * ```
+     */
+    static bancor::server::response handle( const bancor::server::book& book, const bancor::server::request& req )
+    {
+        bancor::server::response res;
+        res.id = req.id;
+        res.version = book.version;
+
+        const bancor::graph& graph = book.graph;
+        try {
+            switch ( req.kind ) {
+                case op::amount_out:
+                case op::amount_in: {
+                    const int64_t index = req.currency ? graph.find_multi( symbol_code( req.currency ), name( req.code ) ) : graph.find_legacy( name( req.code ) );
+                    if ( index < 0 ) break;
+
+                    const bancor::graph::converter& conv = graph.converters[index];
+                    const bancor::graph::reserve* in = nullptr;
+                    const bancor::graph::reserve* out = nullptr;
+                    for ( uint8_t i = 0; i < conv.size; ++i ) {
+                        const uint64_t code = graph.tokens[conv.reserves[i].token].code.raw();
+                        if ( code == req.symbol_in ) in = &conv.reserves[i];
+                        else if ( code == req.symbol_out ) out = &conv.reserves[i];
+                    }
+                    if ( in == nullptr || out == nullptr ) break;
+
+                    res.amount = req.kind == op::amount_out
+                        ? bancor::get_amount_out( req.amount, in->balance, in->weight, out->balance, out->weight, conv.fee )
+                        : bancor::get_amount_in( req.amount, in->balance, in->weight, out->balance, out->weight, conv.fee );
+                    res.hops = 1;
+                    return res;
+                }
+                case op::route: {
+                    const bancor::token token_in = { name( req.contract_in ), symbol_code( req.symbol_in ) };
+                    const bancor::token token_out = { name( req.contract_out ), symbol_code( req.symbol_out ) };
+                    const vector<bancor::route_quote> quotes = bancor::get_routes( graph, token_in, token_out, req.amount, 1, req.max_hops ? req.max_hops : 3 );
+                    if ( quotes.empty() ) break;
+
+                    res.amount = quotes[0].amount_out;
+                    res.hops = quotes[0].path.size;
+                    return res;
+                }
+                default:
+                    res.result = status::invalid;
+                    return res;
+            }
+        } catch ( const std::exception& ) {
+            res.result = status::invalid;
+            return res;
+        }
+        res.result = status::not_found;
+        return res;
+    }
+
+    // prices every complete frame of `buffer` on one view, returns the bytes consumed
+    static size_t process( const bancor::server::store& store, const uint32_t slot, const char* buffer, const size_t size, vector<bancor::server::response>& responses )
+    {
+        const size_t count = size / sizeof( request );
+        if ( count == 0 ) return 0;
+
+        const auto view = store.read( slot );
+        for ( size_t i = 0; i < count; ++i ) {
+            request req;
+            std::memcpy( &req, buffer + i * sizeof( request ), sizeof( request ) );
+            responses.push_back( bancor::server::handle( *view, req ) );
+        }
+        return count * sizeof( request );
+    }
+
+    // write all bytes (blocking descriptor), false when the peer is gone
+    static bool write_all( const int fd, const void* data, size_t size )
+    {
+        const char* ptr = static_cast<const char*>( data );
+        while ( size > 0 ) {
+            const ssize_t n = ::write( fd, ptr, size );
+            if ( n < 0 && errno == EINTR ) continue;
+            if ( n <= 0 ) return false;
+            ptr += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    /**
+     * ## STATIC `serve`
+     *
+     * Serve request frames from `in` and write responses to `out` until end of stream (pipes, socket pairs)
+     *
+     * Pipelined requests read together are priced on the same book version.
+     *
+     * ### params
+     *
+     * - `{store} store` - converter store
+     * - `{uint32_t} slot` - reader slot of the calling thread
+     * - `{int} in` - request descriptor
+     * - `{int} out` - response descriptor
+     *
+     * ### example
+     *
+     * ```c++
+     * std::thread worker( [&] { bancor::server::serve( store, 0, STDIN_FILENO, STDOUT_FILENO ); } );
+     * ```
+     */
+    static void serve( const bancor::server::store& store, const uint32_t slot, const int in, const int out )
+    {
+        static constexpr size_t CAPACITY = 64 * sizeof( request );
+        char buffer[CAPACITY];
+        size_t size = 0;
+        vector<response> responses;
+
+        while ( true ) {
+            const ssize_t n = ::read( in, buffer + size, CAPACITY - size );
+            if ( n < 0 && errno == EINTR ) continue;
+            if ( n <= 0 ) return;
+            size += n;
+
+            responses.clear();
+            const size_t consumed = process( store, slot, buffer, size, responses );
+            std::memmove( buffer, buffer + consumed, size - consumed );
+            size -= consumed;
+            if ( !write_all( out, responses.data(), responses.size() * sizeof( response ) ) ) return;
+        }
+    }
+
+    /**
+     * ## STATIC `query`
+     *
+     * Client helper: send one request frame and wait for its response
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::server::response res = bancor::server::query( fd, req );
+     * ```
+     */
+    static bancor::server::response query( const int fd, const bancor::server::request& req )
+    {
+        bancor::server::response res;
+        res.id = req.id;
+        res.result = status::invalid;
+        if ( !write_all( fd, &req, sizeof( req ) ) ) return res;
+
+        char* ptr = reinterpret_cast<char*>( &res );
+        size_t size = 0;
+        while ( size < sizeof( res ) ) {
+            const ssize_t n = ::read( fd, ptr + size, sizeof( res ) - size );
+            if ( n < 0 && errno == EINTR ) continue;
+            if ( n <= 0 ) {
+                res.result = status::invalid;
+                return res;
+            }
+            size += n;
+        }
+        return res;
+    }
+
+    /**
+     * ## STATIC `connect`
+     *
+     * Client helper: connect to a server listening on a local socket, -1 on failure
+     */
+    static int connect( const char* path )
+    {
+        const int fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+        if ( fd < 0 ) return -1;
+
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::strncpy( addr.sun_path, path, sizeof( addr.sun_path ) - 1 );
+        if ( ::connect( fd, reinterpret_cast<const sockaddr*>( &addr ), sizeof( addr ) ) != 0 ) {
+            ::close( fd );
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * ## STRUCT `listener`
+     *
+     * Thread pool serving a local (unix domain) stream socket
+     *
+     * One accept thread owns the listening socket and hands every new connection to the worker with the fewest open
+     * connections (through that worker's pipe), so workers never race on `accept` and load stays even. Every worker
+     * owns reader slot `worker` and polls its hand-off pipe, its connections and a stop pipe; connections stay on
+     * their worker until closed.
+     *
+     * ### example
+     *
+     * ```c++
+     * bancor::server::store store;
+     * store.update( []( bancor::graph& graph ) { graph.load_multi(); graph.load_legacy( "bnt2eoscnvrt"_n ); } );
+     *
+     * bancor::server::listener server( store, "/tmp/sx.bancor.sock", 8 );
+     * server.start();
+     *
+     * // feed thread (single writer)
+     * store.set_multi( bancor::multi::load( row ) );
+     * ```
+     */
+    struct listener {
+        listener( const bancor::server::store& store, const char* path, const uint32_t threads ) : _store( store ), _threads( threads )
+        {
+            eosio::check( threads > 0 && threads <= bancor::server::store::MAX_READERS, "sx.bancor::server: invalid thread count");
+            eosio::check( std::strlen( path ) < sizeof( sockaddr_un::sun_path ), "sx.bancor::server: socket path too long");
+
+            sockaddr_un addr = {};
+            addr.sun_family = AF_UNIX;
+            std::strncpy( addr.sun_path, path, sizeof( addr.sun_path ) - 1 );
+            ::unlink( path );
+
+            _fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+            eosio::check( _fd >= 0, "sx.bancor::server: cannot create socket");
+            eosio::check( ::bind( _fd, reinterpret_cast<const sockaddr*>( &addr ), sizeof( addr ) ) == 0, "sx.bancor::server: cannot bind socket");
+            eosio::check( ::listen( _fd, 128 ) == 0, "sx.bancor::server: cannot listen");
+            eosio::check( ::fcntl( _fd, F_SETFL, ::fcntl( _fd, F_GETFL ) | O_NONBLOCK ) == 0, "sx.bancor::server: cannot configure socket");
+            eosio::check( ::pipe( _stop ) == 0, "sx.bancor::server: cannot create stop pipe");
+            _path = path;
+
+            _state.reset( new worker_state[threads] );
+            for ( uint32_t worker = 0; worker < threads; ++worker ) {
+                int* handoff = _state[worker].handoff;
+                eosio::check( ::pipe( handoff ) == 0, "sx.bancor::server: cannot create hand-off pipe");
+                eosio::check( ::fcntl( handoff[0], F_SETFL, ::fcntl( handoff[0], F_GETFL ) | O_NONBLOCK ) == 0, "sx.bancor::server: cannot configure socket");
+            }
+        }
+
+        listener( const listener& ) = delete;
+        listener& operator=( const listener& ) = delete;
+
+        ~listener()
+        {
+            stop();
+            for ( uint32_t worker = 0; worker < _threads; ++worker ) {
+                ::close( _state[worker].handoff[0] );
+                ::close( _state[worker].handoff[1] );
+            }
+            ::close( _stop[0] );
+            ::close( _stop[1] );
+            ::close( _fd );
+            ::unlink( _path.c_str() );
+        }
+
+        void start()
+        {
+            for ( uint32_t worker = 0; worker < _threads; ++worker ) _workers.emplace_back( [this, worker] { run( worker ); } );
+            _workers.emplace_back( [this] { dispatch(); } );
+        }
+
+        // wake the accept thread & every worker, close their connections and join
+        void stop()
+        {
+            if ( _workers.empty() ) return;
+            const char byte = 0;
+            write_all( _stop[1], &byte, 1 );
+            for ( std::thread& worker : _workers ) worker.join();
+            _workers.clear();
+        }
+
+        // open connections of a worker
+        uint32_t connections( const uint32_t worker ) const
+        {
+            return _state[worker].connections.load( std::memory_order_relaxed );
+        }
+
+    private:
+        struct connection {
+            int         fd;
+            size_t      size = 0;
+            char        buffer[64 * sizeof( request )] = {};
+        };
+
+        struct worker_state {
+            int                     handoff[2] = { -1, -1 };
+            std::atomic<uint32_t>   connections{ 0 };
+        };
+
+        // accept thread: drain the backlog, each connection to the least loaded worker
+        void dispatch()
+        {
+            pollfd fds[2] = { { _fd, POLLIN, 0 }, { _stop[0], POLLIN, 0 } };
+            while ( true ) {
+                if ( ::poll( fds, 2, -1 ) < 0 ) {
+                    if ( errno == EINTR ) continue;
+                    break;
+                }
+                if ( fds[1].revents ) break;
+
+                while ( true ) {
+                    const int fd = ::accept( _fd, nullptr, nullptr );
+                    if ( fd < 0 && (errno == EINTR || errno == ECONNABORTED) ) continue;
+                    if ( fd < 0 ) break;
+
+                    uint32_t target = 0;
+                    for ( uint32_t worker = 1; worker < _threads; ++worker ) {
+                        if ( connections( worker ) < connections( target ) ) target = worker;
+                    }
+                    _state[target].connections.fetch_add( 1, std::memory_order_relaxed );
+                    if ( write_all( _state[target].handoff[1], &fd, sizeof( fd ) ) ) continue;
+                    _state[target].connections.fetch_sub( 1, std::memory_order_relaxed );
+                    ::close( fd );
+                }
+            }
+        }
+
+        void run( const uint32_t worker )
+        {
+            worker_state& state = _state[worker];
+            vector<pollfd> fds = { { state.handoff[0], POLLIN, 0 }, { _stop[0], POLLIN, 0 } };
+            vector<std::unique_ptr<connection>> connections;
+            vector<response> responses;
+            int incoming[64];
+
+            while ( true ) {
+                if ( ::poll( fds.data(), fds.size(), -1 ) < 0 ) {
+                    if ( errno == EINTR ) continue;
+                    break;
+                }
+                if ( fds[1].revents ) break;
+
+                // connections handed off by the accept thread (whole descriptors, pipe writes are atomic)
+                if ( fds[0].revents & POLLIN ) {
+                    const ssize_t n = ::read( state.handoff[0], incoming, sizeof( incoming ) );
+                    for ( ssize_t i = 0; i < n / static_cast<ssize_t>( sizeof( int ) ); ++i ) {
+                        fds.push_back( { incoming[i], POLLIN, 0 } );
+                        connections.emplace_back( new connection{ incoming[i] } );
+                    }
+                }
+
+                for ( size_t i = fds.size(); i-- > 2; ) {
+                    if ( fds[i].revents == 0 ) continue;
+                    connection& conn = *connections[i - 2];
+                    const ssize_t n = ::read( conn.fd, conn.buffer + conn.size, sizeof( conn.buffer ) - conn.size );
+                    bool open = n > 0 || (n < 0 && errno == EINTR);
+                    if ( n > 0 ) {
+                        conn.size += n;
+                        responses.clear();
+                        const size_t consumed = process( _store, worker, conn.buffer, conn.size, responses );
+                        std::memmove( conn.buffer, conn.buffer + consumed, conn.size - consumed );
+                        conn.size -= consumed;
+                        open = write_all( conn.fd, responses.data(), responses.size() * sizeof( response ) );
+                    }
+                    if ( open ) continue;
+
+                    ::close( conn.fd );
+                    fds.erase( fds.begin() + i );
+                    connections.erase( connections.begin() + (i - 2) );
+                    state.connections.fetch_sub( 1, std::memory_order_relaxed );
+                }
+            }
+            for ( const auto& conn : connections ) ::close( conn->fd );
+
+            // connections handed off after the stop
+            for ( ssize_t n; (n = ::read( state.handoff[0], incoming, sizeof( incoming ) )) > 0; ) {
+                for ( ssize_t i = 0; i < n / static_cast<ssize_t>( sizeof( int ) ); ++i ) ::close( incoming[i] );
+            }
+            state.connections.store( 0, std::memory_order_relaxed );
+        }
+
+        const bancor::server::store&    _store;
+        const uint32_t                  _threads;
+        int                             _fd = -1;
+        int                             _stop[2] = { -1, -1 };
+        std::string                     _path;
+        std::unique_ptr<worker_state[]> _state;
+        vector<std::thread>             _workers;       // workers, then the accept thread
+    };
+}
+}
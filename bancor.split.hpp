@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "bancor.graph.hpp"
+
+namespace bancor {
+
+    /**
+     * ## STRUCT `split`
+     *
+     * Allocation of one order across parallel converters (returned by `get_split`)
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_out` - exact total output (sum of `amounts_out`)
+     * - `{vector<uint64_t>} amounts_in` - input amount sent to each converter (sums to the order amount)
+     * - `{vector<uint64_t>} amounts_out` - exact `get_amount_out` of each converter
+     * - `{vector<uint32_t>} converters` - graph converter index of each entry (input position for `get_split( hops, ... )`)
+     * - `{uint8_t} iterations` - Newton (or bisection) iterations used
+     */
+    struct split {
+        uint64_t            amount_out = 0;
+        vector<uint64_t>    amounts_in;
+        vector<uint64_t>    amounts_out;
+        vector<uint32_t>    converters;
+        uint8_t             iterations = 0;
+    };
+
+    /**
+     * ## STATIC `get_split`
+     *
+     * Given an input amount and converters quoting the same pair, returns the split maximizing the total output
+     *
+     * Water-filling: at the optimum every used converter has the same marginal output `λ`. With `p = w_in / w_out`
+     * and spot rate `s` (after fees), `out'(x) = s * (R_in / (R_in + x))^(p + 1)`, so each allocation has the closed form
+     * `x(λ) = max(0, R_in * ((s / λ)^(1 / (p + 1)) - 1))`; Newton on `ln λ` solves `Σ x(λ) = amount_in` (convex, monotone
+     * convergence from the starting point), kept inside a bracket of the root with bisection as fallback for extreme weight ratios. Integer floors are completed and polished with exact prices (units moved
+     * between converters while the total improves), then re-verified with `get_amount_out` (never worse than the best
+     * single converter).
+     *
+     * ### params
+     *
+     * - `{vector<hop>} hops` - parallel converters (same input & output token)
+     * - `{uint64_t} amount_in` - total amount input
+     *
+     * ### example
+     *
+     * ```c++
+     * // EOS => BNT: EOSBNT (multi) & bnt2eoscnvrt (legacy)
+     * const bancor::split res = bancor::get_split( {
+     *     { 579884155, 500000, 2164526259891919, 500000, 2000 },
+     *     { 559884608, 500000, 2042781014136003, 500000, 2000 }
+     * }, 100000000 );
+     * // res.amounts_in => [ 54407937, 45592063 ]
+     * // res.amount_out => 338131173444185 (EOSBNT alone => 317094728139000)
+     * ```
+     */
+    static bancor::split get_split( const vector<bancor::hop>& hops, const uint64_t amount_in )
+    {
+        // Newton / bisection iterations, largest `exp` argument & polish moves per step size
+        static constexpr uint8_t MAX_ITERATIONS = 96;
+        static constexpr double MAX_EXPONENT = 600;
+        static constexpr uint32_t MAX_MOVES = 256;
+
+        // checks
+        eosio::check(amount_in > 0, "sx.bancor: INSUFFICIENT_INPUT_AMOUNT");
+        eosio::check(!hops.empty(), "sx.bancor: INVALID_ROUTE");
+
+        const size_t size = hops.size();
+        bancor::split res;
+        res.amounts_in.assign( size, 0 );
+        res.amounts_out.assign( size, 0 );
+        for ( size_t i = 0; i < size; ++i ) res.converters.push_back( i );
+
+        // per converter: R_in, 1 / (p + 1), ln(spot rate after fees) & exact outputs of the polish moves
+        struct state { double reserve, exponent, log_spot; uint64_t more, less; };
+        vector<state> states( size );
+        size_t best = 0;
+        for ( size_t i = 0; i < size; ++i ) {
+            const hop& item = hops[i];
+            eosio::check(item.reserve_in > 0 && item.reserve_out > 0, "sx.bancor: INSUFFICIENT_LIQUIDITY");
+            eosio::check(item.reserve_weight_in > 0 && item.reserve_weight_out > 0, "sx.bancor: INVALID_WEIGHT");
+            eosio::check(item.fee <= formula::MAX_FEE, "sx.bancor: INVALID_FEE");
+
+            const double weight = static_cast<double>(item.reserve_weight_in) / item.reserve_weight_out;
+            const double fee = static_cast<double>((formula::MAX_FEE - item.fee) * (formula::MAX_FEE - item.fee)) * 1e-12;
+            states[i].reserve = static_cast<double>(item.reserve_in);
+            states[i].exponent = 1 / (weight + 1);
+            states[i].log_spot = std::log( static_cast<double>(item.reserve_out) * weight * fee / states[i].reserve );
+            if ( states[i].log_spot > states[best].log_spot ) best = i;
+        }
+
+        // allocation of a converter at marginal rate `mu` (exponent clamped, `exp` stays finite for extreme weight ratios)
+        const auto get_scale = [&]( const size_t i, const double mu ) {
+            return std::min( (states[i].log_spot - mu) * states[i].exponent, MAX_EXPONENT );
+        };
+
+        // start at the marginal rate of the best converter taking everything (Σ x >= amount_in); the root stays
+        // bracketed in [lo, hi] and any Newton step leaving the bracket (or not finite) falls back to bisection
+        const double total = static_cast<double>(amount_in);
+        double lo = states[best].log_spot - std::log1p( total / states[best].reserve ) / states[best].exponent;
+        double hi = states[best].log_spot;
+        double mu = lo, step = hi - lo, last = step;
+        for ( ; res.iterations < MAX_ITERATIONS; ++res.iterations ) {
+            double excess = -total, slope = 0;
+            bool clamped = false;
+            for ( size_t i = 0; i < size; ++i ) {
+                if ( states[i].log_spot <= mu ) continue;
+                const double exponent = get_scale( i, mu );
+                const double scale = std::exp( exponent );
+                clamped |= exponent == MAX_EXPONENT;
+                excess += states[i].reserve * (scale - 1);
+                slope -= states[i].reserve * scale * states[i].exponent;
+            }
+            if ( excess >= 0 ) lo = mu;
+            else hi = mu;
+            if ( (excess >= 0 && excess < 0.5) || !(hi - lo > 0) ) break;
+
+            // bisection when Newton leaves the bracket or converges slower than halving (steep exponentials)
+            const double newton = excess / slope;
+            const double next = mu - newton;
+            const bool bisect = clamped || !std::isfinite( next ) || !(next > lo && next < hi) || std::fabs( 2 * newton ) > std::fabs( last );
+            last = step;
+            step = bisect ? (hi - lo) / 2 : newton;
+            mu = bisect ? lo + step : next;
+            if ( mu == lo || mu == hi ) break;
+        }
+        mu = lo;
+
+        // exact output of one converter
+        const auto get_out = [&]( const size_t i, const uint64_t amount ) -> uint64_t {
+            if ( amount == 0 ) return 0;
+            return bancor::get_amount_out( amount, hops[i].reserve_in, hops[i].reserve_weight_in, hops[i].reserve_out, hops[i].reserve_weight_out, hops[i].fee );
+        };
+
+        // integer floors (never above amount_in)
+        uint64_t allocated = 0;
+        for ( size_t i = 0; i < size; ++i ) {
+            if ( states[i].log_spot <= mu ) continue;
+            const double x = states[i].reserve * std::expm1( get_scale( i, mu ) );
+            const uint64_t remainder = amount_in - allocated;
+            res.amounts_in[i] = x > 0 ? (x < static_cast<double>(remainder) ? static_cast<uint64_t>(x) : remainder) : 0;
+            allocated += res.amounts_in[i];
+        }
+        for ( size_t i = 0; i < size; ++i ) res.amounts_out[i] = get_out( i, res.amounts_in[i] );
+
+        // remainder: bulk to the best marginal output, exact gains compared per converter
+        while ( allocated < amount_in ) {
+            const uint64_t remainder = amount_in - allocated;
+            const uint64_t step = remainder > size ? remainder / size : 1;
+            size_t target = 0;
+            uint64_t target_out = 0, target_gain = 0;
+            for ( size_t i = 0; i < size; ++i ) {
+                const uint64_t out = get_out( i, res.amounts_in[i] + step );
+                if ( i == 0 || out - res.amounts_out[i] > target_gain ) {
+                    target = i;
+                    target_out = out;
+                    target_gain = out - res.amounts_out[i];
+                }
+            }
+            res.amounts_in[target] += step;
+            res.amounts_out[target] = target_out;
+            allocated += step;
+        }
+
+        // exact polish: move units from the cheapest donor to the best receiver while the total improves (floor rounding),
+        // a bounded number of moves per step size
+        for ( uint64_t step = 16; step > 0; step /= 4 ) {
+            for ( uint32_t moves = 0; moves < MAX_MOVES; ++moves ) {
+                size_t to = 0;
+                for ( size_t i = 0; i < size; ++i ) {
+                    states[i].more = get_out( i, res.amounts_in[i] + step );
+                    if ( states[i].more - res.amounts_out[i] > states[to].more - res.amounts_out[to] ) to = i;
+                }
+                size_t from = size;
+                for ( size_t i = 0; i < size; ++i ) {
+                    if ( i == to || res.amounts_in[i] < step ) continue;
+                    states[i].less = get_out( i, res.amounts_in[i] - step );
+                    if ( from == size || res.amounts_out[i] - states[i].less < res.amounts_out[from] - states[from].less ) from = i;
+                }
+                if ( from == size || states[to].more - res.amounts_out[to] <= res.amounts_out[from] - states[from].less ) break;
+                res.amounts_in[from] -= step;
+                res.amounts_in[to] += step;
+                res.amounts_out[from] = states[from].less;
+                res.amounts_out[to] = states[to].more;
+            }
+        }
+
+        // exact re-verification
+        for ( const uint64_t out : res.amounts_out ) res.amount_out += out;
+        const uint64_t single_out = get_out( best, amount_in );
+        if ( single_out > res.amount_out ) {
+            res.amounts_in.assign( size, 0 );
+            res.amounts_out.assign( size, 0 );
+            res.amounts_in[best] = amount_in;
+            res.amounts_out[best] = single_out;
+            res.amount_out = single_out;
+        }
+        return res;
+    }
+
+    /**
+     * ## STATIC `get_split`
+     *
+     * Given an input amount, input and output tokens, split the order across every direct converter of the graph
+     *
+     * ### params
+     *
+     * - `{graph} graph` - converter graph
+     * - `{token} token_in` - input token
+     * - `{token} token_out` - output token
+     * - `{uint64_t} amount_in` - total amount input
+     *
+     * ### example
+     *
+     * ```c++
+     * const bancor::split res = bancor::get_split( graph, { "eosio.token"_n, {"EOS"} }, { "bntbntbntbnt"_n, {"BNT"} }, 100000000 );
+     * // graph.converters[res.converters[0]] => EOSBNT
+     * ```
+     */
+    static bancor::split get_split( const bancor::graph& graph, const bancor::token& token_in, const bancor::token& token_out, const uint64_t amount_in )
+    {
+        const int64_t from = graph.find_token( token_in );
+        const int64_t to = graph.find_token( token_out );
+        eosio::check(from >= 0 && to >= 0, "sx.bancor: INVALID_ROUTE");
+
+        vector<bancor::hop> hops;
+        vector<uint32_t> converters;
+        for ( const graph::edge& item : graph.edges[from] ) {
+            if ( item.to != static_cast<uint32_t>(to) ) continue;
+            hops.push_back( graph.get_hop( item ) );
+            converters.push_back( item.converter );
+        }
+        eosio::check(!hops.empty(), "sx.bancor: INVALID_ROUTE");
+
+        bancor::split res = bancor::get_split( hops, amount_in );
+        res.converters = converters;
+        return res;
+    }
+}
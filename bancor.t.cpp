@@ -5,6 +5,20 @@
 #include <uint128_t/uint128_t.cpp>
 
 #include "bancor.hpp"
+#include "bancor.route.hpp"
+#include "bancor.fast.hpp"
+#include "bancor.legacy.hpp"
+#include "bancor.multi.hpp"
+#include "bancor.graph.hpp"
+#include "bancor.arbitrage.hpp"
+#include "bancor.split.hpp"
+#include "bancor.pool.hpp"
+#include "bancor.server.hpp"
+#include "bancor.seqlock.hpp"
+#include "bancor.delta.hpp"
+#include "bancor.image.hpp"
+
+#include <fixtures/bancor.hpp>
 
 TEST_CASE( "get_amount_out #1 (pass)" ) {
     // Inputs
@@ -36,20 +50,196 @@ TEST_CASE( "get_amount_out #2 (pass)" ) {
     REQUIRE( amount_out == 27300 );
 }
 
-// TEST_CASE( "get_amount_in #1 (pass)" ) {
-//     // Inputs
-//     const uint64_t amount_out = 27328;
-//     const uint64_t reserve_in = 45851931234;
-//     const uint64_t reserve_weight_in = 50000;
-//     const uint64_t reserve_out = 125682033533;
-//     const uint64_t reserve_weight_out = 50000;
-//     const uint64_t fee = 2000;
+TEST_CASE( "get_amount_out #3 (weights)" ) {
+    // Inputs
+    const uint64_t amount_in = 10000;
+    const uint64_t reserve_in = 100000000;
+    const uint64_t reserve_weight_in = 400000;
+    const uint64_t reserve_out = 400000000;
+    const uint64_t reserve_weight_out = 600000;
+    const uint64_t fee = 2000;
+
+    // Calculation
+    const uint64_t amount_out = bancor::get_amount_out( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee);
+
+    REQUIRE( amount_out == 26557 );
+}
+
+TEST_CASE( "get_amount_out #4 (weights)" ) {
+    // Inputs
+    const uint64_t amount_in = 1000000;
+    const uint64_t reserve_in = 578125412;
+    const uint64_t reserve_weight_in = 250000;
+    const uint64_t reserve_out = 2170087186740517;
+    const uint64_t reserve_weight_out = 500000;
+    const uint64_t fee = 2000;
+
+    // Calculation
+    const uint64_t amount_out = bancor::get_amount_out( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee);
+
+    REQUIRE( amount_out == 1866909421996 );
+}
+
+TEST_CASE( "get_amount_out #5 (rational weights)" ) {
+    // Inputs
+    const uint64_t amount_in = 10000;
+    const uint64_t reserve_in = 100000000;
+    const uint64_t reserve_out = 400000000;
+    const uint64_t fee = 2000;
+
+    // Calculation (4/1, 1/2, 3/2 weight ratios)
+    REQUIRE( bancor::get_amount_out( amount_in, reserve_in, 800000, reserve_out, 200000, fee ) == 159320 );
+    REQUIRE( bancor::get_amount_out( amount_in, reserve_in, 250000, reserve_out, 500000, fee ) == 19918 );
+    REQUIRE( bancor::get_amount_out( amount_in, reserve_in, 600000, reserve_out, 400000, fee ) == 59752 );
+}
+
+TEST_CASE( "formula::optimal_log & optimal_exp" ) {
+    // ln(3) => 1.0986122886681098
+    REQUIRE( bancor::formula::general_log( 3, 1 ) == (static_cast<safemath::uint128_t>(1) << 64) + 0x193EA7AAD030A975 );
+
+    // sqrt
+    REQUIRE( bancor::formula::sqrt_ceil( 16 ) == 4 );
+    REQUIRE( bancor::formula::sqrt_ceil( 17 ) == 5 );
+
+    // e^-1 => 0.36787944117144233
+    REQUIRE( bancor::formula::optimal_exp( bancor::formula::fixed_1() ) == 0x5E2D58D8B3BCDF1D );
+}
+
+TEST_CASE( "get_amount_in #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount_out = 27300;
+    const uint64_t reserve_in = 45851931234;
+    const uint64_t reserve_weight_in = 50000;
+    const uint64_t reserve_out = 125682033533;
+    const uint64_t reserve_weight_out = 50000;
+    const uint64_t fee = 2000;
+
+    // Calculation
+    const uint64_t amount_in = bancor::get_amount_in( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+
+    REQUIRE( amount_in == 10000 );
+}
+
+TEST_CASE( "get_amount_in #2 (weights)" ) {
+    // Inputs
+    const uint64_t amount_out = 26557;
+    const uint64_t reserve_in = 100000000;
+    const uint64_t reserve_weight_in = 400000;
+    const uint64_t reserve_out = 400000000;
+    const uint64_t reserve_weight_out = 600000;
+    const uint64_t fee = 2000;
+
+    // Calculation
+    const uint64_t amount_in = bancor::get_amount_in( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+
+    REQUIRE( amount_in == 10000 );
+    REQUIRE( bancor::get_amount_out( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee ) >= amount_out );
+    REQUIRE( bancor::get_amount_out( amount_in - 1, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee ) < amount_out );
+}
+
+TEST_CASE( "get_amount_in #3 (output above reserve)" ) {
+    // 128-bit fee step used to wrap & return a tiny input
+    REQUIRE( eosio::testing::check_failure( [] { bancor::get_amount_in( 1ULL << 63, 1000000, 500000, 1000, 500000, 2000 ); } ) == "sx.bancor: INSUFFICIENT_LIQUIDITY" );
+    REQUIRE( eosio::testing::check_failure( [] { bancor::get_amount_in( 1ULL << 63, 1000000, 500000, 1, 500000, 2000 ); } ) == "sx.bancor: INSUFFICIENT_LIQUIDITY" );
+    REQUIRE( eosio::testing::check_failure( [] { bancor::get_amount_in( 1000, 1000000, 500000, 1000, 500000, 2000 ); } ) == "sx.bancor: INSUFFICIENT_LIQUIDITY" );
+    REQUIRE( bancor::get_amount_out( bancor::get_amount_in( 900, 1000000, 500000, 1000, 500000, 2000 ), 1000000, 500000, 1000, 500000, 2000 ) >= 900 );
+
+    // same guard for converters & the quote server
+    bancor::multi::snapshot converter;
+    converter.currency = symbol( symbol_code{"EOSBNT"}, 4 );
+    converter.fee = 2000;
+    converter.size = 2;
+    converter.symbols[0] = symbol_code{"BNT"};
+    converter.symbols[1] = symbol_code{"EOS"};
+    converter.reserves[0] = bancor::multi::reserve{ "bntbntbntbnt"_n, 500000, asset( 1000, symbol( symbol_code{"BNT"}, 4 ) ) };
+    converter.reserves[1] = bancor::multi::reserve{ "eosio.token"_n, 500000, asset( 1000000, symbol( symbol_code{"EOS"}, 4 ) ) };
+    REQUIRE( eosio::testing::check_failure( [&] { bancor::multi::get_amount_in( converter, {"EOS"}, {"BNT"}, 1ULL << 63 ); } ) == "sx.bancor: INSUFFICIENT_LIQUIDITY" );
+
+    bancor::server::book book;
+    book.version = 1;
+    book.graph.set_multi( converter );
+    bancor::server::request req = {};
+    req.kind = bancor::server::op::amount_in;
+    req.code = bancor::multi::code.value;
+    req.currency = symbol_code{"EOSBNT"}.raw();
+    req.symbol_in = symbol_code{"EOS"}.raw();
+    req.symbol_out = symbol_code{"BNT"}.raw();
+    req.amount = 1ULL << 63;
+    bancor::server::response res;
+    eosio::testing::check_failure( [&] { res = bancor::server::handle( book, req ); } );
+    REQUIRE( res.result == bancor::server::status::invalid );
+}
+
+TEST_CASE( "route #1 (single hop)" ) {
+    const bancor::route path = {{ 45851931234, 500000, 125682033533, 500000, 2000 }};
+
+    REQUIRE( bancor::get_amount_out( path, 10000 ) == 27300 );
+    REQUIRE( bancor::get_amount_in( path, 27300 ) == 10000 );
+}
+
+TEST_CASE( "route #2 (multi hop)" ) {
+    // EOS => BNT => USDT
+    const bancor::route path = {
+        { 579884155, 500000, 2164526259891919, 500000, 2000 },
+        { 2170087186740517, 500000, 1254361234, 500000, 2000 }
+    };
+    const uint64_t amount_out = bancor::get_amount_out( path, 10000 );
+    const uint64_t amount_in = bancor::get_amount_in( path, amount_out );
+
+    REQUIRE( amount_out == 21402 );
+    REQUIRE( amount_in == 10000 );
+    REQUIRE( bancor::get_amount_out( path, amount_in - 1 ) < amount_out );
+
+    // weighted hops, intermediate amount is not rounded
+    const bancor::route weighted = {
+        { 100000000, 400000, 400000000, 600000, 2000 },
+        { 400000000, 600000, 100000000, 400000, 2000 }
+    };
+    REQUIRE( bancor::get_amount_out( weighted, 10000 ) == 9918 );
+    REQUIRE( bancor::get_amount_in( weighted, 9918 ) == 10000 );
+}
+
+TEST_CASE( "fast::get_amount_out (bounds)" ) {
+    const bancor::fast::interval out = bancor::fast::get_amount_out_interval( 10000, 45851931234, 500000, 125682033533, 500000, 2000 );
+    REQUIRE( out.lower == 27299 );
+    REQUIRE( out.upper == 27301 );
+
+    // lower <= exact <= upper (extreme weight ratios: the integer kernel is far below the real output)
+    const bancor::hop hops[] = {
+        { 100000000, 400000, 400000000, 600000, 2000 },
+        { 578125412, 250000, 2170087186740517, 500000, 2000 },
+        { 100000000, 800000, 400000000, 200000, 2000 },
+        { 45851931234, 450000, 125682033533, 550000, 30000 },
+        { 1000000000000000000, 1000000, 1000000000000000000, 1, 2000 },
+        { 45851931234, 999999, 8000000000000000000, 7, 2000 }
+    };
+    for ( const bancor::hop& item : hops ) {
+        const bancor::fast::pool pool = item;
+        for ( uint64_t amount_in = 1; amount_in <= 10000000000; amount_in *= 10 ) {
+            const uint64_t amount_out = bancor::get_amount_out( amount_in, item.reserve_in, item.reserve_weight_in, item.reserve_out, item.reserve_weight_out, item.fee );
+            const bancor::fast::interval bounds = bancor::fast::get_amount_out_interval( pool, amount_in );
+            REQUIRE( bounds.lower <= amount_out );
+            REQUIRE( bounds.upper >= amount_out );
+            REQUIRE( bancor::fast::get_amount_out( pool, amount_in ) == bounds.lower );
+        }
+    }
+}
+
+TEST_CASE( "uint128_t divmod (128 / 64 & 128 / 128)" ) {
+    const ::uint128_t max( 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF );
+    const ::uint128_t x( 0x0123456789ABCDEF, 0xFEDCBA9876543210 );
 
-//     // Calculation
-//     const uint64_t amount_in = bancor::get_amount_in( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+    // 64-bit divisor
+    REQUIRE( max / 3 == ::uint128_t( 0x5555555555555555, 0x5555555555555555 ) );
+    REQUIRE( max / 0xFFFFFFFFFFFFFFFF == ::uint128_t( 1, 1 ) );
+    REQUIRE( x / 0xF00DBABE12345 == ::uint128_t( 0x13, 0x69EA97CF9089B5CE ) );
+    REQUIRE( x % 0xF00DBABE12345 == 0x5E230494D078A );
 
-//     REQUIRE( amount_in == 10000 );
-// }
+    // 128-bit divisor
+    REQUIRE( max / ::uint128_t( 1, 1 ) == 0xFFFFFFFFFFFFFFFF );
+    REQUIRE( x / ::uint128_t( 0x1B, 0x2C3D4E5F60718293 ) == 0xAB81E44193F15 );
+    REQUIRE( x % ::uint128_t( 0x1B, 0x2C3D4E5F60718293 ) == ::uint128_t( 0x16, 0x4DB84D0AD1874F01 ) );
+}
 
 TEST_CASE( "quote #1 (pass)" ) {
     // Inputs
@@ -64,3 +254,902 @@ TEST_CASE( "quote #1 (pass)" ) {
 
     REQUIRE( amount_b == 27410 );
 }
+
+TEST_CASE( "quote #2 (large reserves)" ) {
+    // Inputs
+    const uint64_t amount_a = 1000000;
+    const uint64_t reserve_a = 578125412;
+    const uint64_t reserve_b = 2170087186740517;
+
+    // Calculation (reserve_b * 1000000 exceeds 64 bits)
+    REQUIRE( bancor::quote( amount_a, reserve_a, 500000, reserve_b, 500000 ) == 3753661647968 );
+    REQUIRE( bancor::quote( amount_a, reserve_a, 400000, reserve_b, 600000 ) == 2502441098645 );
+}
+
+TEST_CASE( "get_price (spot, marginal & impact)" ) {
+    // spot price in Q.64 (weights & fees)
+    REQUIRE( bancor::spot_price( 4, 500000, 10, 500000, 0 ) == static_cast<safemath::uint128_t>(5) << 63 );
+    REQUIRE( bancor::spot_price( 4, 800000, 10, 200000, 0 ) == static_cast<safemath::uint128_t>(10) << 64 );
+    REQUIRE( bancor::spot_price( 1000000, 500000, 1000000, 500000, 500000 ) == static_cast<safemath::uint128_t>(1) << 62 );
+
+    // single kernel evaluation: same output as get_amount_out
+    const bancor::price res = bancor::get_price( 10000000000, 45851931234, 500000, 125682033533, 500000, 2000 );
+    REQUIRE( res.amount_out == 22412798512 );
+    REQUIRE( res.price_impact == 326033 );
+    REQUIRE( res.slippage == 179045 );
+    REQUIRE( res.marginal_price == bancor::marginal_price( 10000000000, 45851931234, 500000, 125682033533, 500000, 2000 ) );
+    REQUIRE( res.price_impact == bancor::price_impact( 10000000000, 45851931234, 500000, 125682033533, 500000, 2000 ) );
+
+    // marginal <= execution <= spot
+    for ( const uint64_t weight_in : { 500000, 800000, 200000, 450000 } ) {
+        for ( uint64_t amount_in = 1; amount_in <= 100000000000; amount_in *= 10 ) {
+            const bancor::price item = bancor::get_price( amount_in, 45851931234, weight_in, 125682033533, 500000, 2000 );
+            REQUIRE( item.amount_out == bancor::get_amount_out( amount_in, 45851931234, weight_in, 125682033533, 500000, 2000 ) );
+            REQUIRE( item.marginal_price <= item.spot_price );
+            REQUIRE( item.slippage <= item.price_impact );
+            REQUIRE( item.amount_out <= (item.spot_price * amount_in) >> 64 );
+        }
+    }
+}
+
+TEST_CASE( "purchase_return, sale_return, fund_cost & liquidate_return" ) {
+    // Inputs (EOS reserve of EOSBNT, 100000.0000 EOSBNT supply)
+    const uint64_t supply = 1000000000;
+    const uint64_t reserve_balance = 579884155;
+
+    // reserve => smart token => reserve (rounded down, never returns more than deposited)
+    REQUIRE( bancor::purchase_return( supply, reserve_balance, 500000, 10000000, 2000 ) == 8568383 );
+    REQUIRE( bancor::purchase_return( supply, reserve_balance, 1000000, 10000000, 2000 ) == 17210333 );
+    REQUIRE( bancor::sale_return( supply, reserve_balance, 500000, 10000000, 2000 ) == 11516614 );
+    REQUIRE( bancor::sale_return( supply, reserve_balance, 500000, supply, 0 ) == reserve_balance );
+    REQUIRE( bancor::sale_return( supply + 8568383, reserve_balance + 10000000, 500000, 8568383, 0 ) <= 10000000 );
+
+    // fund rounded up, liquidate rounded down (1% of the supply => 1% of each reserve)
+    REQUIRE( bancor::fund_cost( supply, reserve_balance, 1000000, 10000000 ) == 5798842 );
+    REQUIRE( bancor::liquidate_return( supply, reserve_balance, 1000000, 10000000 ) == 5798841 );
+    REQUIRE( bancor::fund_cost( supply, reserve_balance, 400000, 10000000 ) == 14606014 );
+    REQUIRE( bancor::liquidate_return( supply, reserve_balance, 400000, 10000000 ) == 14388557 );
+    REQUIRE( bancor::liquidate_return( supply, reserve_balance, 900000, supply ) == reserve_balance );
+}
+
+TEST_CASE( "safemath::mul_div" ) {
+    // 128-bit intermediate
+    REQUIRE( safemath::mul_div( 10000, 125682033533, 45851931234 ) == 27410 );
+    REQUIRE( safemath::mul_div( 10000, 125682033533, 45851931234, safemath::rounding::up ) == 27411 );
+    REQUIRE( safemath::mul_div( 6, 4, 3, safemath::rounding::up ) == 8 );
+    REQUIRE( safemath::mul_div( UINT64_MAX, UINT64_MAX, UINT64_MAX ) == UINT64_MAX );
+
+    // 192-bit intermediate
+    const safemath::uint128_t y = safemath::mul( 2170087186740517, 400000 );
+    const safemath::uint128_t z = safemath::mul( 578125412, 600000 );
+    REQUIRE( safemath::mul_div( 1000000, y, z ) == 2502441098645 );
+    REQUIRE( safemath::mul_div( 1000000, y, z, safemath::rounding::up ) == 2502441098646 );
+    REQUIRE( safemath::mul_div( UINT64_MAX, safemath::mul( UINT64_MAX, 3 ), safemath::mul( UINT64_MAX, 4 ) ) == UINT64_MAX / 4 * 3 + 2 );
+}
+
+TEST_CASE( "multi::load (one read)" ) {
+    bancor::load_fixtures();
+    const bancor::multi::snapshot converter = bancor::multi::load( {"EOSBNT"} );
+
+    REQUIRE( eosio::testing::stats().reads() == 1 );
+    REQUIRE( converter.fee == 2000 );
+    REQUIRE( converter.size == 2 );
+    REQUIRE( converter.get( {"EOS"} ).balance.to_string() == "57988.4155 EOS" );
+    REQUIRE( converter.get( {"BNT"} ).contract == "bntbntbntbnt"_n );
+    REQUIRE( converter.get( {"BNT"} ).weight == 500000 );
+    REQUIRE( converter.find( {"USDT"} ) == nullptr );
+
+    // same quote as the raw reserves
+    REQUIRE( bancor::multi::get_amount_out( converter, {"EOS"}, {"BNT"}, 10000 ) == bancor::get_amount_out( 10000, 579884155, 500000, 2164526259891919, 500000, 2000 ) );
+}
+
+TEST_CASE( "multi::get_reserves & get_fee" ) {
+    bancor::load_fixtures();
+    const std::vector<bancor::multi::reserve> reserves = bancor::multi::get_reserves( {"EOSBNT"} );
+    const uint64_t fee = bancor::multi::get_fee( {"EOSBNT"} );
+
+    REQUIRE( eosio::testing::stats().reads() == 2 );
+    REQUIRE( reserves.size() == 2 );
+    REQUIRE( reserves[0].balance.to_string() == "57988.4155 EOS" );
+    REQUIRE( reserves[1].balance.to_string() == "216452.6259891919 BNT" );
+    REQUIRE( fee == 2000 );
+}
+
+TEST_CASE( "multi::get_reserves & get_fee (more than MAX_RESERVES)" ) {
+    bancor::load_fixtures();
+    std::string weights, balances;
+    for ( const char* code : { "AAA", "BBB", "CCC", "DDD", "EEE", "FFF", "GGG", "HHH", "III" } ) {
+        weights += std::string( weights.empty() ? "" : ", " ) + R"({ "key": ")" + code + R"(", "value": 100000 })";
+        balances += std::string( balances.empty() ? "" : ", " ) + R"({ "key": ")" + code + R"(", "value": { "quantity": "1.0000 )" + code + R"(", "contract": "tokens" } })";
+    }
+    eosio::testing::set_row( "bancorcnvrtr"_n, "bancorcnvrtr"_n.value, "converter.v2"_n, symbol_code{"NINEBNT"}.raw(), eosio::testing::json::parse(
+        R"({ "currency": "4,NINEBNT", "owner": "guztoojqgege", "fee": 3000, "reserve_weights": [)" + weights + R"(], "reserve_balances": [)" + balances + R"(], "protocol_features": [], "metadata_json": [] })" ) );
+
+    const std::vector<bancor::multi::reserve> reserves = bancor::multi::get_reserves( {"NINEBNT"} );
+    REQUIRE( reserves.size() == bancor::multi::snapshot::MAX_RESERVES + 1 );
+    REQUIRE( reserves[8].balance.to_string() == "1.0000 III" );
+    REQUIRE( reserves[8].weight == 100000 );
+    REQUIRE( bancor::multi::get_reserve( {"NINEBNT"}, {"III"} ).contract == "tokens"_n );
+    REQUIRE( bancor::multi::get_fee( {"NINEBNT"} ) == 3000 );
+
+    // snapshots stay bounded
+    REQUIRE( eosio::testing::check_failure( [] { bancor::multi::load( {"NINEBNT"} ); } ) == "sx.bancor::multi: too many reserves" );
+}
+
+TEST_CASE( "multi route (EOS => BNT => USDT)" ) {
+    bancor::load_fixtures();
+    const bancor::multi::snapshot eosbnt = bancor::multi::load( {"EOSBNT"} );
+    const bancor::multi::snapshot usdtbnt = bancor::multi::load( {"USDTBNT"} );
+    const bancor::route path = { bancor::multi::get_hop( eosbnt, {"EOS"}, {"BNT"} ), bancor::multi::get_hop( usdtbnt, {"BNT"}, {"USDT"} ) };
+
+    REQUIRE( eosio::testing::stats().reads() == 2 );
+    REQUIRE( bancor::get_amount_out( path, 10000 ) == 21402 );
+}
+
+TEST_CASE( "pool (3 reserves, one-to-all quotes & single-sided deposit)" ) {
+    bancor::load_fixtures();
+    eosio::testing::set_row( "bancorcnvrtr"_n, "bancorcnvrtr"_n.value, "converter.v2"_n, symbol_code{"TRIBNT"}.raw(), eosio::testing::json::parse( R"({
+        "currency": "4,TRIBNT", "owner": "guztoojqgege", "fee": 2000,
+        "reserve_weights": [{ "key": "EOS", "value": 300000 }, { "key": "BNT", "value": 300000 }, { "key": "USDT", "value": 400000 }],
+        "reserve_balances": [
+            { "key": "EOS", "value": { "quantity": "57988.4155 EOS", "contract": "eosio.token" } },
+            { "key": "BNT", "value": { "quantity": "216452.6259891919 BNT", "contract": "bntbntbntbnt" } },
+            { "key": "USDT", "value": { "quantity": "152400.0000 USDT", "contract": "tethertether" } }
+        ],
+        "protocol_features": [], "metadata_json": []
+    })" ) );
+    const bancor::pool pool = bancor::get_pool( bancor::multi::load( {"TRIBNT"} ) );
+
+    REQUIRE( pool.size == 3 );
+    REQUIRE( pool.total_weight == 1000000 );
+    REQUIRE( pool.index( {"USDT"} ) == 2 );
+    REQUIRE( pool.find( {"XYZ"} ) == -1 );
+    REQUIRE( pool.curves[0][2] == bancor::formula::curve::general );
+
+    // one-to-all quotes equal the pairwise quotes
+    uint64_t amounts_out[bancor::pool::MAX_RESERVES];
+    for ( uint8_t in = 0; in < pool.size; ++in ) {
+        for ( const uint64_t amount_in : { 1ULL, 10000ULL, 100000000ULL, 1000000000000ULL } ) {
+            bancor::get_amounts_out( pool, in, amount_in, amounts_out );
+            REQUIRE( amounts_out[in] == 0 );
+            for ( uint8_t out = 0; out < pool.size; ++out ) {
+                if ( out == in ) continue;
+                REQUIRE( amounts_out[out] == bancor::get_amount_out( amount_in, pool.balances[in], pool.weights[in], pool.balances[out], pool.weights[out], pool.fee ) );
+                REQUIRE( amounts_out[out] == bancor::get_amount_out( pool, in, out, amount_in ) );
+            }
+        }
+    }
+    REQUIRE( bancor::get_amount_in( pool, 0, 2, bancor::get_amount_out( pool, 0, 2, 10000 ) ) <= 10000 );
+
+    // single-sided deposit & withdrawal use the reserve weight, proportional ones the total weight
+    REQUIRE( bancor::get_deposit_return( pool, 1000000000, 0, 10000000 ) == bancor::purchase_return( 1000000000, 579884155, 300000, 10000000, 2000 ) );
+    REQUIRE( bancor::get_withdraw_return( pool, 1000000000, 2, 10000000 ) == bancor::sale_return( 1000000000, 1524000000, 400000, 10000000, 2000 ) );
+
+    uint64_t costs[bancor::pool::MAX_RESERVES];
+    uint64_t returns[bancor::pool::MAX_RESERVES];
+    bancor::get_fund_costs( pool, 1000000000, 10000000, costs );
+    bancor::get_liquidate_returns( pool, 1000000000, 10000000, returns );
+    REQUIRE( costs[0] == 5798842 );
+    REQUIRE( returns[0] == 5798841 );
+    REQUIRE( costs[2] == bancor::fund_cost( 1000000000, 1524000000, 1000000, 10000000 ) );
+}
+
+TEST_CASE( "legacy::load (settings, reserves & balances)" ) {
+    bancor::load_fixtures();
+    const bancor::legacy::snapshot converter = bancor::legacy::load( "bnt2eoscnvrt"_n );
+
+    // settings exists + get, reserves begin + 2 next, one accounts get per token contract
+    REQUIRE( eosio::testing::stats().finds == 5 );
+    REQUIRE( eosio::testing::stats().nexts == 2 );
+    REQUIRE( converter.fee == 2000 );
+    REQUIRE( converter.size == 2 );
+    REQUIRE( converter.get( {"EOS"} ).balance.to_string() == "55988.4608 EOS" );
+    REQUIRE( converter.get( {"BNT"} ).balance.to_string() == "204278.1014136003 BNT" );
+    REQUIRE( converter.get( {"BNT"} ).weight == 500000 );
+}
+
+TEST_CASE( "legacy::get_reserve & get_fee" ) {
+    bancor::load_fixtures();
+    const bancor::legacy::reserve reserve = bancor::legacy::get_reserve( "bnt2eoscnvrt"_n, {"EOS"} );
+
+    REQUIRE( reserve.contract == "eosio.token"_n );
+    REQUIRE( reserve.balance.to_string() == "55988.4608 EOS" );
+    REQUIRE( bancor::legacy::get_fee( "bnt2eoscnvrt"_n ) == 2000 );
+}
+
+TEST_CASE( "legacy::get_reserves & load (missing settings, MAX_RESERVES)" ) {
+    bancor::load_fixtures();
+    const char* codes[] = { "AAA", "BBB", "CCC", "DDD", "EEE", "FFF", "GGG", "HHH", "III" };
+    for ( uint8_t i = 0; i < 9; ++i ) {
+        const symbol_code currency{ codes[i] };
+        const std::string reserve = std::string( R"({"contract": "tokens", "currency": "0.0000 )" ) + codes[i] + R"(", "ratio": 100000, "p_enabled": true})";
+        const std::string balance = std::string( R"({"balance": ")" ) + std::to_string( i + 1 ) + ".0000 " + codes[i] + R"("})";
+        if ( i < 8 ) eosio::testing::set_row( "eightcnvrtr"_n, "eightcnvrtr"_n.value, "reserves"_n, currency.raw(), eosio::testing::json::parse( reserve ) );
+        eosio::testing::set_row( "ninecnvrtr"_n, "ninecnvrtr"_n.value, "reserves"_n, currency.raw(), eosio::testing::json::parse( reserve ) );
+        eosio::testing::set_row( "tokens"_n, "eightcnvrtr"_n.value, "accounts"_n, currency.raw(), eosio::testing::json::parse( balance ) );
+        eosio::testing::set_row( "tokens"_n, "ninecnvrtr"_n.value, "accounts"_n, currency.raw(), eosio::testing::json::parse( balance ) );
+    }
+
+    // table walk, no settings & no reserve limit
+    const auto reserves = bancor::legacy::get_reserves( "ninecnvrtr"_n );
+    REQUIRE( reserves.size() == 9 );
+    REQUIRE( reserves[8].balance.to_string() == "9.0000 III" );
+    REQUIRE( eosio::testing::check_failure( [] { bancor::legacy::load( "ninecnvrtr"_n ); } ) == "sx.bancor::legacy: settings does not exists" );
+
+    // snapshot: up to MAX_RESERVES inclusive
+    const std::string settings = R"({"smart_contract": "relay", "smart_currency": "0.0000 RELAY", "smart_enabled": true, "enabled": true, "network": "thisisbancor", "require_balance": false, "max_fee": 30000, "fee": 1000})";
+    eosio::testing::set_row( "eightcnvrtr"_n, "eightcnvrtr"_n.value, "settings"_n, "settings"_n.value, eosio::testing::json::parse( settings ) );
+    eosio::testing::set_row( "ninecnvrtr"_n, "ninecnvrtr"_n.value, "settings"_n, "settings"_n.value, eosio::testing::json::parse( settings ) );
+    const bancor::legacy::snapshot eight = bancor::legacy::load( "eightcnvrtr"_n );
+    REQUIRE( eight.size == bancor::legacy::snapshot::MAX_RESERVES );
+    REQUIRE( eight.get( {"HHH"} ).balance.to_string() == "8.0000 HHH" );
+    REQUIRE( eosio::testing::check_failure( [] { bancor::legacy::load( "ninecnvrtr"_n ); } ) == "sx.bancor::legacy: too many reserves" );
+}
+
+TEST_CASE( "graph::get_routes (multi & legacy converters)" ) {
+    bancor::load_fixtures();
+    bancor::graph graph;
+    graph.load_multi();
+    graph.load_legacy( "bnt2eoscnvrt"_n );
+
+    const bancor::token eos = { "eosio.token"_n, {"EOS"} };
+    const bancor::token bnt = { "bntbntbntbnt"_n, {"BNT"} };
+    const bancor::token usdt = { "tethertether"_n, {"USDT"} };
+
+    // converter scan (begin + 2 next) + legacy load (7 reads)
+    REQUIRE( eosio::testing::stats().reads() == 10 );
+    REQUIRE( graph.tokens.size() == 3 );
+    REQUIRE( graph.converters.size() == 3 );
+
+    // parallel converters, best output first
+    const std::vector<bancor::route_quote> direct = bancor::get_routes( graph, eos, bnt, 10000 );
+    REQUIRE( direct.size() == 2 );
+    REQUIRE( direct[0].amount_out == 37177074374 );
+    REQUIRE( graph.converters[direct[0].converters[0]].currency == symbol_code{"EOSBNT"} );
+    REQUIRE( direct[1].amount_out == 36339304435 );
+    REQUIRE( graph.converters[direct[1].converters[0]].code == "bnt2eoscnvrt"_n );
+
+    // EOS => BNT => USDT, same output as the hand-built route
+    const std::vector<bancor::route_quote> routes = bancor::get_routes( graph, eos, usdt, 10000 );
+    REQUIRE( routes.size() == 2 );
+    REQUIRE( routes[0].amount_out == 21402 );
+    REQUIRE( routes[0].path.size == 2 );
+    REQUIRE( routes[1].amount_out == 20920 );
+    REQUIRE( bancor::get_routes( graph, eos, usdt, 10000, 1 ).size() == 1 );
+    REQUIRE( bancor::get_routes( graph, eos, usdt, 10000, 3, 1 ).empty() );
+
+    // incremental update: one converter re-read, only its edges change
+    eosio::testing::set_row( "bancorcnvrtr"_n, "bancorcnvrtr"_n.value, "converter.v2"_n, symbol_code{"EOSBNT"}.raw(), eosio::testing::json::parse( R"({
+        "currency": "4,EOSBNT", "owner": "guztoojqgege", "fee": 2000,
+        "reserve_weights": [{ "key": "EOS", "value": 500000 }, { "key": "BNT", "value": 500000 }],
+        "reserve_balances": [
+            { "key": "EOS", "value": { "quantity": "57988.4155 EOS", "contract": "eosio.token" } },
+            { "key": "BNT", "value": { "quantity": "108226.3129945959 BNT", "contract": "bntbntbntbnt" } }
+        ],
+        "protocol_features": [], "metadata_json": []
+    })" ) );
+    eosio::testing::reset_stats();
+    graph.update_multi( {"EOSBNT"} );
+
+    REQUIRE( eosio::testing::stats().reads() == 1 );
+    REQUIRE( graph.converters.size() == 3 );
+    REQUIRE( bancor::get_routes( graph, eos, usdt, 10000 )[0].amount_out == 20920 );
+}
+
+TEST_CASE( "graph::get_routes (malformed converters are inactive)" ) {
+    bancor::load_fixtures();
+    bancor::graph graph;
+    graph.load_multi();
+    graph.load_legacy( "bnt2eoscnvrt"_n );
+
+    const bancor::token eos = { "eosio.token"_n, {"EOS"} };
+    const bancor::token bnt = { "bntbntbntbnt"_n, {"BNT"} };
+
+    // same pair at a much better spot price, weight above MAX_WEIGHT
+    bancor::multi::snapshot heavy = bancor::multi::load( {"EOSBNT"} );
+    heavy.currency = symbol( symbol_code{"HEAVYBNT"}, 4 );
+    const uint8_t reserve = heavy.symbols[0] == symbol_code{"EOS"} ? 0 : 1;
+    heavy.reserves[reserve].weight = bancor::formula::MAX_WEIGHT * 2;
+    graph.set_multi( heavy );
+
+    // fee above MAX_FEE
+    bancor::multi::snapshot costly = bancor::multi::load( {"EOSBNT"} );
+    costly.currency = symbol( symbol_code{"COSTLYBNT"}, 4 );
+    costly.fee = bancor::formula::MAX_FEE + 1;
+    graph.set_multi( costly );
+
+    REQUIRE( graph.converters.size() == 5 );
+    REQUIRE( std::none_of( graph.edges[graph.find_token( eos )].begin(), graph.edges[graph.find_token( eos )].end(), [&]( const bancor::graph::edge& item ) {
+        return item.converter == graph.find_multi( {"HEAVYBNT"} ) || item.converter == graph.find_multi( {"COSTLYBNT"} );
+    } ) );
+
+    // routing skips them instead of failing
+    const std::vector<bancor::route_quote> direct = bancor::get_routes( graph, eos, bnt, 10000 );
+    REQUIRE( direct.size() == 2 );
+    REQUIRE( direct[0].amount_out == 37177074374 );
+
+    // a valid refresh re-activates the converter
+    heavy.reserves[reserve].weight = 500000;
+    graph.set_multi( heavy );
+    REQUIRE( bancor::get_routes( graph, eos, bnt, 10000 ).size() == 3 );
+}
+
+TEST_CASE( "arbitrage (EOS => BNT => EOS)" ) {
+    bancor::load_fixtures();
+    bancor::arbitrage engine;
+
+    // EOSBNT & USDTBNT alone have no cycle
+    REQUIRE( engine.load_multi().empty() );
+
+    // EOSBNT pays 3.7327 BNT per EOS, bnt2eoscnvrt sells EOS at 3.6486 BNT
+    const std::vector<bancor::cycle> cycles = engine.load_legacy( "bnt2eoscnvrt"_n );
+    REQUIRE( cycles.size() == 1 );
+
+    const bancor::cycle& item = cycles[0];
+    REQUIRE( item.cost < 0 );
+    REQUIRE( item.path.size == 2 );
+    REQUIRE( engine.graph.tokens[item.tokens[0]].code == symbol_code{"EOS"} );
+    REQUIRE( engine.graph.converters[item.converters[0]].currency == symbol_code{"EOSBNT"} );
+    REQUIRE( engine.graph.converters[item.converters[1]].code == "bnt2eoscnvrt"_n );
+
+    // optimal size (exact prices)
+    REQUIRE( item.amount_in == 2093209 );
+    REQUIRE( item.amount_out == 2108739 );
+    REQUIRE( item.amount_out == bancor::get_amount_out( item.path, item.amount_in ) );
+    REQUIRE( bancor::get_amount_out( item.path, item.amount_in - 300000 ) - (item.amount_in - 300000) < item.amount_out - item.amount_in );
+    REQUIRE( bancor::get_amount_out( item.path, item.amount_in + 300000 ) - (item.amount_in + 300000) < item.amount_out - item.amount_in );
+
+    // suspended, then reported again when one of its converters is updated
+    REQUIRE( engine.update_legacy( "bnt2eoscnvrt"_n ).size() == 1 );
+
+    // EOSBNT at the legacy price => fees exceed the spread
+    eosio::testing::set_row( "bancorcnvrtr"_n, "bancorcnvrtr"_n.value, "converter.v2"_n, symbol_code{"EOSBNT"}.raw(), eosio::testing::json::parse( R"({
+        "currency": "4,EOSBNT", "owner": "guztoojqgege", "fee": 2000,
+        "reserve_weights": [{ "key": "EOS", "value": 500000 }, { "key": "BNT", "value": 500000 }],
+        "reserve_balances": [
+            { "key": "EOS", "value": { "quantity": "55988.4608 EOS", "contract": "eosio.token" } },
+            { "key": "BNT", "value": { "quantity": "204278.1014136003 BNT", "contract": "bntbntbntbnt" } }
+        ],
+        "protocol_features": [], "metadata_json": []
+    })" ) );
+    REQUIRE( engine.update_multi( {"EOSBNT"} ).empty() );
+}
+
+TEST_CASE( "arbitrage (cycle longer than route::MAX_HOPS)" ) {
+    bancor::arbitrage engine;
+
+    // ring of 9 converters, each paying ~1.1 of the next token: the only negative cycle has 9 hops
+    const uint8_t size = bancor::route::MAX_HOPS + 1;
+    std::vector<bancor::cycle> found;
+    bancor::multi::snapshot snapshot;
+    for ( uint8_t i = 0; i < size; ++i ) {
+        const symbol_code in = symbol_code{ std::string( 1, 'A' + i ) };
+        const symbol_code out = symbol_code{ std::string( 1, 'A' + (i + 1) % size ) };
+        snapshot.currency = symbol( symbol_code{ std::string( "RING" ) + std::string( 1, 'A' + i ) }, 4 );
+        snapshot.fee = 2000;
+        snapshot.size = 2;
+        snapshot.symbols[0] = in;
+        snapshot.symbols[1] = out;
+        snapshot.reserves[0] = { "token"_n, 500000, asset{ 1000000000, symbol{ in, 4 } } };
+        snapshot.reserves[1] = { "token"_n, 500000, asset{ 1100000000, symbol{ out, 4 } } };
+        found = engine.set_multi( snapshot );
+    }
+
+    // reported (flagged, cost only) instead of silently suspended
+    REQUIRE( found.size() == 1 );
+    REQUIRE( found[0].too_long );
+    REQUIRE( found[0].cost < 0 );
+    REQUIRE( found[0].path.size == 0 );
+    REQUIRE( found[0].amount_in == 0 );
+
+    // suspended, then reported again when one of its converters is updated
+    REQUIRE( engine.set_multi( snapshot ).size() == 1 );
+}
+
+TEST_CASE( "arbitrage (relaxation budget & rounding)" ) {
+    bancor::load_fixtures();
+    bancor::arbitrage full;
+    full.load_multi();
+    const std::vector<bancor::cycle> expected = full.load_legacy( "bnt2eoscnvrt"_n );
+    REQUIRE( expected.size() == 1 );
+    REQUIRE_FALSE( full.exhausted );
+
+    // one relaxation per run: the search is kept pending instead of dropped
+    bancor::arbitrage engine;
+    engine.max_relaxations = 1;
+    std::vector<bancor::cycle> found = engine.load_multi();
+    REQUIRE( engine.exhausted );
+    for ( const bancor::cycle& item : engine.load_legacy( "bnt2eoscnvrt"_n ) ) found.push_back( item );
+
+    uint32_t runs = 0;
+    for ( ; engine.exhausted && runs < 100; ++runs ) {
+        for ( const bancor::cycle& item : engine.resume() ) found.push_back( item );
+    }
+    REQUIRE( runs > 0 );
+    REQUIRE_FALSE( engine.exhausted );
+    REQUIRE( found.size() == 1 );
+    REQUIRE( found[0].amount_in == expected[0].amount_in );
+    REQUIRE( found[0].amount_out == expected[0].amount_out );
+    REQUIRE( engine.resume().empty() );
+
+    // profitable at the spot price (1.44), not after integer rounding: reported with no input
+    bancor::arbitrage tiny;
+    bancor::multi::snapshot snapshot;
+    snapshot.fee = 0;
+    snapshot.size = 2;
+    for ( uint8_t i = 0; i < 2; ++i ) {
+        const symbol_code in = symbol_code{ i ? "B" : "A" };
+        const symbol_code out = symbol_code{ i ? "A" : "B" };
+        snapshot.currency = symbol( symbol_code{ i ? "TINYB" : "TINYA" }, 0 );
+        snapshot.symbols[0] = in;
+        snapshot.symbols[1] = out;
+        snapshot.reserves[0] = { "token"_n, 500000, asset{ 10, symbol{ in, 0 } } };
+        snapshot.reserves[1] = { "token"_n, 500000, asset{ 12, symbol{ out, 0 } } };
+        found = tiny.set_multi( snapshot );
+    }
+    REQUIRE( found.size() == 1 );
+    REQUIRE( found[0].cost < 0 );
+    REQUIRE( found[0].path.size == 2 );
+    REQUIRE( found[0].amount_in == 0 );
+    REQUIRE( found[0].amount_out == 0 );
+}
+
+TEST_CASE( "get_split (EOS => BNT across EOSBNT & bnt2eoscnvrt)" ) {
+    bancor::load_fixtures();
+    bancor::graph graph;
+    graph.load_multi();
+    graph.load_legacy( "bnt2eoscnvrt"_n );
+
+    const bancor::token eos = { "eosio.token"_n, {"EOS"} };
+    const bancor::token bnt = { "bntbntbntbnt"_n, {"BNT"} };
+
+    // small orders stay on the best converter
+    const bancor::split small = bancor::get_split( graph, eos, bnt, 10000 );
+    REQUIRE( small.amount_out == 37177074374 );
+    REQUIRE( small.amounts_in[0] == 10000 );
+    REQUIRE( small.amounts_in[1] == 0 );
+
+    // 10000 EOS split across both converters
+    const bancor::split res = bancor::get_split( graph, eos, bnt, 100000000 );
+    REQUIRE( res.amounts_in[0] == 54407937 );
+    REQUIRE( res.amounts_in[1] == 45592063 );
+    REQUIRE( res.amount_out == 338131173444185 );
+    REQUIRE( res.amount_out > bancor::get_routes( graph, eos, bnt, 100000000 )[0].amount_out );
+    REQUIRE( res.iterations <= 4 );
+    REQUIRE( graph.converters[res.converters[0]].currency == symbol_code{"EOSBNT"} );
+    REQUIRE( graph.converters[res.converters[1]].code == "bnt2eoscnvrt"_n );
+
+    // exact re-verification & no better neighbouring allocation
+    const bancor::hop a = { 579884155, 500000, 2164526259891919, 500000, 2000 };
+    const bancor::hop b = { 559884608, 500000, 2042781014136003, 500000, 2000 };
+    const auto total = [&]( const uint64_t x ) {
+        return bancor::get_amount_out( x, a.reserve_in, a.reserve_weight_in, a.reserve_out, a.reserve_weight_out, a.fee )
+             + bancor::get_amount_out( 100000000 - x, b.reserve_in, b.reserve_weight_in, b.reserve_out, b.reserve_weight_out, b.fee );
+    };
+    REQUIRE( bancor::get_split( { a, b }, 100000000 ).amount_out == res.amount_out );
+    REQUIRE( total( res.amounts_in[0] ) == res.amount_out );
+    for ( const uint64_t delta : { 1, 10, 1000, 100000 } ) {
+        REQUIRE( total( res.amounts_in[0] + delta ) <= res.amount_out );
+        REQUIRE( total( res.amounts_in[0] - delta ) <= res.amount_out );
+    }
+}
+
+TEST_CASE( "get_split (extreme weight ratios)" ) {
+    // 1000000:1 weights => one unit drains the first converter, the second takes the rest
+    const bancor::hop steep = { 1000, 1000000, 1000000000, 1, 0 };
+    const bancor::hop flat = { 1000000000, 1, 1000000000, 1, 0 };
+    const bancor::split res = bancor::get_split( { steep, flat }, 1000000000000 );
+    REQUIRE( res.amounts_in[0] + res.amounts_in[1] == 1000000000000 );
+    REQUIRE( res.amounts_in[0] == 1 );
+    REQUIRE( res.amount_out == 1999000998 );
+    REQUIRE( res.iterations < 96 );
+
+    // reversed order & ratios, never below the best single converter
+    const bancor::hop shallow = { 1000000000, 1, 1000, 1000000, 0 };
+    const bancor::split reversed = bancor::get_split( { flat, shallow, steep }, 1000000000000 );
+    REQUIRE( reversed.amounts_in[0] + reversed.amounts_in[1] + reversed.amounts_in[2] == 1000000000000 );
+    REQUIRE( reversed.amount_out >= res.amount_out );
+    for ( const bancor::hop& item : { steep, flat, shallow } ) {
+        REQUIRE( reversed.amount_out >= bancor::get_amount_out( 1000000000000, item.reserve_in, item.reserve_weight_in, item.reserve_out, item.reserve_weight_out, item.fee ) );
+    }
+}
+
+TEST_CASE( "server (store versions, frames over a socket pair & local socket)" ) {
+    bancor::load_fixtures();
+    bancor::server::store store;
+    store.update( []( bancor::graph& graph ) {
+        graph.load_multi();
+        graph.load_legacy( "bnt2eoscnvrt"_n );
+    });
+
+    bancor::server::request pair;
+    pair.id = 7;
+    pair.kind = bancor::server::op::amount_out;
+    pair.code = "bancorcnvrtr"_n.value;
+    pair.currency = symbol_code{"EOSBNT"}.raw();
+    pair.symbol_in = symbol_code{"EOS"}.raw();
+    pair.symbol_out = symbol_code{"BNT"}.raw();
+    pair.amount = 10000;
+
+    bancor::server::request route;
+    route.kind = bancor::server::op::route;
+    route.contract_in = "eosio.token"_n.value;
+    route.symbol_in = symbol_code{"EOS"}.raw();
+    route.contract_out = "tethertether"_n.value;
+    route.symbol_out = symbol_code{"USDT"}.raw();
+    route.amount = 10000;
+
+    // converter quotes, inverse & routes priced on one book
+    {
+        const auto view = store.read( 0 );
+        const bancor::server::response res = bancor::server::handle( *view, pair );
+        REQUIRE( res.id == 7 );
+        REQUIRE( res.result == bancor::server::status::ok );
+        REQUIRE( res.amount == 37177074374 );
+        REQUIRE( res.version == 1 );
+
+        bancor::server::request inverse = pair;
+        inverse.kind = bancor::server::op::amount_in;
+        inverse.amount = res.amount;
+        REQUIRE( bancor::server::handle( *view, inverse ).amount == 10000 );
+
+        bancor::server::request legacy = pair;
+        legacy.code = "bnt2eoscnvrt"_n.value;
+        legacy.currency = 0;
+        REQUIRE( bancor::server::handle( *view, legacy ).amount == bancor::get_amount_out( 10000, 559884608, 500000, 2042781014136003, 500000, 2000 ) );
+
+        const bancor::server::response best = bancor::server::handle( *view, route );
+        REQUIRE( best.amount == bancor::get_routes( view->graph, { "eosio.token"_n, {"EOS"} }, { "tethertether"_n, {"USDT"} }, 10000 )[0].amount_out );
+        REQUIRE( best.hops == 2 );
+
+        bancor::server::request missing = pair;
+        missing.symbol_out = symbol_code{"USDT"}.raw();
+        REQUIRE( bancor::server::handle( *view, missing ).result == bancor::server::status::not_found );
+    }
+
+    // a pinned reader keeps its version, the retired book is freed once released
+    {
+        const auto view = store.read( 1 );
+        store.update( []( bancor::graph& graph ) { graph.converters[0].fee = 3000; } );
+        REQUIRE( view->version == 1 );
+        REQUIRE( store.version() == 2 );
+        REQUIRE( store.retired() == 1 );
+    }
+    store.reclaim();
+    REQUIRE( store.retired() == 0 );
+    REQUIRE( bancor::server::handle( *store.read( 0 ), pair ).version == 2 );
+
+    // pipelined frames over a socket pair
+    int fds[2];
+    REQUIRE( ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) == 0 );
+    std::thread worker( [&] { bancor::server::serve( store, 2, fds[1], fds[1] ); } );
+    const bancor::server::request frames[] = { pair, route };
+    REQUIRE( bancor::server::write_all( fds[0], frames, sizeof( frames ) ) );
+    bancor::server::response responses[2];
+    REQUIRE( ::recv( fds[0], responses, sizeof( responses ), MSG_WAITALL ) == sizeof( responses ) );
+    REQUIRE( responses[0].id == 7 );
+    REQUIRE( responses[1].hops == 2 );
+    ::shutdown( fds[0], SHUT_WR );
+    worker.join();
+    ::close( fds[0] );
+    ::close( fds[1] );
+
+    // thread pool on a local socket
+    const std::string path = "/tmp/sx.bancor.t." + std::to_string( ::getpid() ) + ".sock";
+    bancor::server::listener server( store, path.c_str(), 2 );
+    server.start();
+    const int client = bancor::server::connect( path.c_str() );
+    REQUIRE( client >= 0 );
+    REQUIRE( bancor::server::query( client, pair ).amount == bancor::server::handle( *store.read( 0 ), pair ).amount );
+    ::close( client );
+
+    // one accept thread, connections spread over the least loaded workers
+    int clients[4];
+    for ( int& fd : clients ) {
+        fd = bancor::server::connect( path.c_str() );
+        REQUIRE( fd >= 0 );
+        REQUIRE( bancor::server::query( fd, pair ).result == bancor::server::status::ok );
+    }
+    REQUIRE( server.connections( 0 ) >= 2 );
+    REQUIRE( server.connections( 1 ) >= 2 );
+    for ( const int fd : clients ) ::close( fd );
+    server.stop();
+    REQUIRE( server.connections( 0 ) == 0 );
+}
+
+TEST_CASE( "server::table (seqlock converters keyed by currency)" ) {
+    bancor::load_fixtures();
+    bancor::server::table table( 4 );
+    REQUIRE( table.set( bancor::multi::load( {"EOSBNT"} ) ) );
+    REQUIRE( table.set( bancor::multi::load( {"USDTBNT"} ) ) );
+    REQUIRE( table.size() == 2 );
+    REQUIRE( table.version( {"EOSBNT"} ) == 1 );
+
+    bancor::pool missing;
+    REQUIRE( !table.get( {"XYZBNT"}, missing ) );
+
+    const bancor::pool eosbnt = table.get( {"EOSBNT"} );
+    REQUIRE( eosbnt.contracts[1] == "bntbntbntbnt"_n );
+    REQUIRE( bancor::get_amount_out( eosbnt, eosbnt.index( {"EOS"} ), eosbnt.index( {"BNT"} ), 10000 ) == 37177074374 );
+
+    // the writer moves EOS and BNT together (constant sum), readers never see two different updates
+    const uint64_t total = eosbnt.balances[0] + eosbnt.balances[1];
+    std::atomic<bool> running{ true };
+    std::thread writer( [&] {
+        bancor::pool next = eosbnt;
+        for ( uint64_t i = 1; running.load(); ++i ) {
+            next.balances[0] = eosbnt.balances[0] + i % 1000;
+            next.balances[1] = total - next.balances[0];
+            table.set( {"EOSBNT"}, next );
+        }
+    });
+    uint64_t torn = 0;
+    for ( uint64_t i = 0; i < 200000; ++i ) {
+        bancor::pool current;
+        table.get( {"EOSBNT"}, current );
+        if ( current.balances[0] + current.balances[1] != total ) ++torn;
+    }
+    running = false;
+    writer.join();
+
+    REQUIRE( torn == 0 );
+    REQUIRE( table.version( {"EOSBNT"} ) > 1 );
+    REQUIRE( table.get( {"USDTBNT"} ).balances[0] > 0 );
+}
+
+TEST_CASE( "delta::state (row deltas => snapshots, dirty reserves & graph)" ) {
+    bancor::load_fixtures();
+    const name multi_code = bancor::multi::code;
+    const name legacy_code = "bnt2eoscnvrt"_n;
+
+    // fixture tables as row deltas
+    bancor::delta::writer frames;
+    bancor::multi::converter _converter( multi_code, multi_code.value );
+    for ( const auto& row : _converter ) bancor::delta::encode_frame( frames, bancor::delta::make_row( multi_code, multi_code.value, "converter.v2"_n, row.primary_key(), row ) );
+    bancor::legacy::settings _settings( legacy_code, legacy_code.value );
+    bancor::delta::encode_frame( frames, bancor::delta::make_row( legacy_code, legacy_code.value, "settings"_n, "settings"_n.value, _settings.get() ) );
+    bancor::legacy::reserves _reserves( legacy_code, legacy_code.value );
+    for ( const auto& row : _reserves ) {
+        bancor::delta::encode_frame( frames, bancor::delta::make_row( legacy_code, legacy_code.value, "reserves"_n, row.primary_key(), row ) );
+        bancor::legacy::accounts _accounts( row.contract, legacy_code.value );
+        const bancor::legacy::accounts_row& balance = _accounts.get( row.primary_key(), "no balance" );
+        bancor::delta::encode_frame( frames, bancor::delta::make_row( row.contract, legacy_code.value, "accounts"_n, balance.primary_key(), balance ) );
+    }
+
+    // untracked rows are skipped
+    bancor::legacy::accounts_row other;
+    other.balance = asset( 1, symbol( symbol_code{"EOS"}, 4 ) );
+    bancor::delta::encode_frame( frames, bancor::delta::make_row( "eosio.token"_n, "someone"_n.value, "accounts"_n, other.primary_key(), other ) );
+
+    FILE* file = std::tmpfile();
+    REQUIRE( std::fwrite( frames.data.data(), 1, frames.data.size(), file ) == frames.data.size() );
+    std::fflush( file );
+    std::rewind( file );
+
+    bancor::delta::state state;
+    state.track_legacy( legacy_code );
+    bancor::delta::stream feed( ::fileno( file ) );
+    bancor::delta::dirty dirty;
+    REQUIRE( state.consume( feed, dirty ) == 8 );
+    std::fclose( file );
+
+    // one entry per converter, same snapshots as the table readers
+    REQUIRE( dirty.changes.size() == 3 );
+    REQUIRE( dirty.changes[0].added );
+    REQUIRE( dirty.changes[2].type == bancor::legacy::id );
+    REQUIRE( dirty.changes[2].reserves == 0x3 );
+    const bancor::multi::snapshot eosbnt = state.multi.at( {"EOSBNT"} );
+    REQUIRE( eosbnt.get( {"BNT"} ).balance == bancor::multi::load( {"EOSBNT"} ).get( {"BNT"} ).balance );
+    REQUIRE( state.legacy.at( legacy_code ).snapshot.get( {"EOS"} ).balance == bancor::legacy::load( legacy_code ).get( {"EOS"} ).balance );
+
+    const bancor::token eos = { "eosio.token"_n, {"EOS"} };
+    const bancor::token usdt = { "tethertether"_n, {"USDT"} };
+    bancor::graph graph;
+    bancor::delta::apply( graph, state, dirty );
+    bancor::graph loaded;
+    loaded.load_multi();
+    loaded.load_legacy( legacy_code );
+    REQUIRE( bancor::get_routes( graph, eos, usdt, 10000 )[0].amount_out == bancor::get_routes( loaded, eos, usdt, 10000 )[0].amount_out );
+
+    // one BNT balance moves => only that reserve is dirty
+    dirty.clear();
+    bancor::multi::converter_row row = _converter.get( symbol_code{"EOSBNT"}.raw(), "no converter" );
+    row.reserve_balances[{"BNT"}].quantity.amount -= 1000000000;
+    row.metadata_json["name"_n] = "EOS/BNT";
+    REQUIRE( state.apply( bancor::delta::make_row( multi_code, multi_code.value, "converter.v2"_n, row.primary_key(), row ), dirty ) );
+    REQUIRE( dirty.changes.size() == 1 );
+    REQUIRE( dirty.changes[0].currency == symbol_code{"EOSBNT"} );
+    REQUIRE( dirty.changes[0].reserves == 1 << (eosbnt.symbols[0] == symbol_code{"BNT"} ? 0 : 1) );
+    REQUIRE( !dirty.changes[0].fee );
+
+    // legacy balance, then the converter row erased
+    bancor::legacy::accounts_row balance;
+    balance.balance = asset( 559000000, symbol( symbol_code{"EOS"}, 4 ) );
+    REQUIRE( state.apply( bancor::delta::make_row( "eosio.token"_n, legacy_code.value, "accounts"_n, balance.primary_key(), balance ), dirty ) );
+    bancor::delta::row erased{ false, multi_code, multi_code.value, "converter.v2"_n, symbol_code{"USDTBNT"}.raw(), name{}, "" };
+    REQUIRE( state.apply( erased, dirty ) );
+    REQUIRE( dirty.changes.size() == 3 );
+    const bancor::legacy::snapshot& legacy = state.legacy.at( legacy_code ).snapshot;
+    REQUIRE( dirty.changes[1].reserves == 1 << (legacy.symbols[0] == symbol_code{"EOS"} ? 0 : 1) );
+    REQUIRE( dirty.changes[2].removed );
+
+    bancor::delta::apply( graph, state, dirty );
+    for ( const bancor::graph::edge& item : graph.edges[graph.find_token( eos )] ) {
+        if ( item.converter == graph.find_multi( {"EOSBNT"} ) ) REQUIRE( graph.get_hop( item ).reserve_out == static_cast<uint64_t>(row.reserve_balances[{"BNT"}].quantity.amount) );
+    }
+    REQUIRE( bancor::get_routes( graph, eos, usdt, 10000 ).empty() );
+}
+
+TEST_CASE( "image (binary snapshot written, mapped & quoted in place)" ) {
+    bancor::load_fixtures();
+    const name legacy_code = "bnt2eoscnvrt"_n;
+
+    bancor::image::writer out;
+    bancor::multi::converter _converter( bancor::multi::code, bancor::multi::code.value );
+    for ( const auto& row : _converter ) out.add( bancor::multi::load( row ) );
+    out.add( bancor::legacy::load( legacy_code ) );
+
+    char path[] = "/tmp/bancor.image.XXXXXX";
+    const int fd = ::mkstemp( path );
+    REQUIRE( fd >= 0 );
+    ::close( fd );
+    out.write( path, 123 );
+
+    const bancor::image::file file( path );
+    REQUIRE( file.size() == 3 );
+    REQUIRE( file.get_header().block_num == 123 );
+    REQUIRE( file.verify() );
+    REQUIRE( file.find_multi( {"USDTBNT"} ) != nullptr );
+    REQUIRE( file.find_multi( {"EOSUSDT"} ) == nullptr );
+    REQUIRE( file.find_multi( {"EOSBNT"}, "other"_n ) == nullptr );
+    REQUIRE( file.find_legacy( "other"_n ) == nullptr );
+
+    // quotes straight from the mapping
+    const bancor::image::record* eosbnt = file.find_multi( {"EOSBNT"} );
+    REQUIRE( eosbnt != nullptr );
+    REQUIRE( bancor::image::get_amount_out( *eosbnt, {"EOS"}, {"BNT"}, 10000 ) == 37177074374 );
+    const bancor::image::record* legacy = file.find_legacy( legacy_code );
+    REQUIRE( legacy != nullptr );
+    REQUIRE( bancor::image::get_amount_out( *legacy, {"EOS"}, {"BNT"}, 10000 ) == bancor::legacy::get_amount_out( bancor::legacy::load( legacy_code ), {"EOS"}, {"BNT"}, 10000 ) );
+
+    // lossless snapshots & same routes as the table readers
+    const bancor::multi::snapshot mapped = bancor::image::get_multi( *eosbnt );
+    const bancor::multi::snapshot loaded = bancor::multi::load( {"EOSBNT"} );
+    REQUIRE( mapped.currency == loaded.currency );
+    REQUIRE( mapped.fee == loaded.fee );
+    REQUIRE( mapped.size == loaded.size );
+    for ( uint8_t i = 0; i < mapped.size; ++i ) {
+        REQUIRE( mapped.symbols[i] == loaded.symbols[i] );
+        REQUIRE( mapped.reserves[i].contract == loaded.reserves[i].contract );
+        REQUIRE( mapped.reserves[i].weight == loaded.reserves[i].weight );
+        REQUIRE( mapped.reserves[i].balance == loaded.reserves[i].balance );
+    }
+    REQUIRE( bancor::image::get_legacy( *legacy ).get( {"EOS"} ).balance == bancor::legacy::load( legacy_code ).get( {"EOS"} ).balance );
+
+    const bancor::token eos = { "eosio.token"_n, {"EOS"} };
+    const bancor::token usdt = { "tethertether"_n, {"USDT"} };
+    bancor::graph graph;
+    bancor::image::load( graph, file );
+    bancor::graph tables;
+    tables.load_multi();
+    tables.load_legacy( legacy_code );
+    REQUIRE( bancor::get_routes( graph, eos, usdt, 10000 )[0].amount_out == bancor::get_routes( tables, eos, usdt, 10000 )[0].amount_out );
+
+    // checksum covers the records
+    FILE* damaged = std::fopen( path, "r+b" );
+    REQUIRE( damaged != nullptr );
+    std::fseek( damaged, sizeof( bancor::image::header ) + offsetof( bancor::image::record, fee ), SEEK_SET );
+    std::fputc( 0x7f, damaged );
+    std::fclose( damaged );
+    REQUIRE( !bancor::image::file( path ).verify() );
+
+    // corrupt reserve count of a mapped record => rejected on open
+    const uint64_t sizes[] = { 40, 300 };
+    for ( const uint64_t size : sizes ) {
+        damaged = std::fopen( path, "r+b" );
+        REQUIRE( damaged != nullptr );
+        std::fseek( damaged, sizeof( bancor::image::header ) + sizeof( bancor::image::record ) + offsetof( bancor::image::record, size ), SEEK_SET );
+        REQUIRE( std::fwrite( &size, sizeof( size ), 1, damaged ) == 1 );
+        std::fclose( damaged );
+        REQUIRE( eosio::testing::check_failure( [&] { bancor::image::file corrupt( path ); } ) == "sx.bancor::image: invalid record" );
+    }
+    std::remove( path );
+}
+
+TEST_CASE( "multi::flat_row (snapshot rows, lazy extras & lossless rows)" ) {
+    bancor::load_fixtures();
+
+    bancor::multi::converter _converter( bancor::multi::code, bancor::multi::code.value );
+    bancor::multi::converter_flat _flat( bancor::multi::code, bancor::multi::code.value );
+    for ( const auto& row : _converter ) {
+        const bancor::multi::flat_row& flat = _flat.get( row.primary_key() );
+        const bancor::multi::converter_row copy = bancor::multi::to_row( flat, bancor::multi::get_extras( row.currency.code() ) );
+        bancor::delta::writer a, b;
+        bancor::delta::encode( a, row );
+        bancor::delta::encode( b, copy );
+        REQUIRE( a.data == b.data );
+        REQUIRE( bancor::multi::get_fee( row.currency.code() ) == row.fee );
+    }
+
+    // same snapshot as the map rows
+    const bancor::multi::flat_row& eosbnt = _flat.get( symbol_code{"EOSBNT"}.raw() );
+    const bancor::multi::snapshot loaded = bancor::multi::load( _converter.get( symbol_code{"EOSBNT"}.raw() ) );
+    REQUIRE( eosbnt.snapshot.size == 2 );
+    REQUIRE( eosbnt.snapshot.symbols[0] < eosbnt.snapshot.symbols[1] );
+    for ( uint8_t i = 0; i < loaded.size; ++i ) {
+        REQUIRE( eosbnt.snapshot.symbols[i] == loaded.symbols[i] );
+        REQUIRE( eosbnt.snapshot.reserves[i].contract == loaded.reserves[i].contract );
+        REQUIRE( eosbnt.snapshot.reserves[i].weight == loaded.reserves[i].weight );
+        REQUIRE( eosbnt.snapshot.reserves[i].balance == loaded.reserves[i].balance );
+    }
+    REQUIRE( eosbnt.snapshot.find( {"USDT"} ) == nullptr );
+    REQUIRE( bancor::multi::get_reserve( {"EOSBNT"}, {"BNT"} ).balance == eosbnt.snapshot.get( {"BNT"} ).balance );
+
+    // ABI binary: optional maps skipped, flagged & restored from the full row
+    bancor::multi::converter_row row = _converter.get( symbol_code{"EOSBNT"}.raw() );
+    row.protocol_features["feature"_n] = true;
+    row.metadata_json["name"_n] = "EOS/BNT";
+    row.metadata_json["logo"_n] = "https://example.com/eosbnt.png";
+    bancor::delta::writer bytes;
+    bancor::delta::encode( bytes, row );
+    bancor::delta::reader ds{ bytes.data.data(), bytes.data.data() + bytes.data.size() };
+    bancor::multi::flat_row decoded;
+    ds >> decoded;
+    REQUIRE( ds.pos == ds.end );
+    REQUIRE( decoded.extended );
+    REQUIRE( !eosbnt.extended );
+    REQUIRE( decoded.owner == row.owner );
+    REQUIRE( decoded.snapshot.currency == row.currency );
+    REQUIRE( decoded.snapshot.fee == row.fee );
+    REQUIRE( decoded.snapshot.get( {"EOS"} ).balance == row.reserve_balances.at( {"EOS"} ).quantity );
+    REQUIRE( decoded.snapshot.get( {"BNT"} ).contract == row.reserve_balances.at( {"BNT"} ).contract );
+
+    const bancor::multi::converter_row restored = bancor::multi::to_row( decoded, { row.protocol_features, row.metadata_json } );
+    bancor::delta::writer again;
+    bancor::delta::encode( again, restored );
+    REQUIRE( again.data == bytes.data );
+
+    // every truncation of the row is rejected
+    for ( size_t length = 0; length < bytes.data.size(); ++length ) {
+        REQUIRE( eosio::testing::check_failure( [&]() {
+            bancor::delta::reader partial{ bytes.data.data(), bytes.data.data() + length };
+            bancor::multi::flat_row item;
+            partial >> item;
+        } ) == "sx.bancor::delta: truncated row" );
+    }
+
+    // more than MAX_RESERVES reserves
+    bancor::multi::converter_row wide = row;
+    for ( const char* code : { "A", "B", "C", "D", "F", "G", "H" } ) {
+        wide.reserve_weights[symbol_code{ code }] = 100000;
+        wide.reserve_balances[symbol_code{ code }] = extended_asset( asset( 10000, symbol( symbol_code{ code }, 4 ) ), "token"_n );
+    }
+    REQUIRE( wide.reserve_balances.size() == bancor::multi::snapshot::MAX_RESERVES + 1 );
+    bancor::delta::writer wide_bytes;
+    bancor::delta::encode( wide_bytes, wide );
+    REQUIRE( eosio::testing::check_failure( [&]() {
+        bancor::delta::reader wide_ds{ wide_bytes.data.data(), wide_bytes.data.data() + wide_bytes.data.size() };
+        bancor::multi::flat_row item;
+        wide_ds >> item;
+    } ) == "sx.bancor::multi: too many reserves" );
+
+    // mismatched weight & balance maps, oversized varuint32
+    bancor::multi::converter_row mismatched = row;
+    mismatched.reserve_weights.erase( {"BNT"} );
+    mismatched.reserve_weights[symbol_code{"AAA"}] = 500000;
+    bancor::delta::writer mismatched_bytes;
+    bancor::delta::encode( mismatched_bytes, mismatched );
+    REQUIRE( eosio::testing::check_failure( [&]() {
+        bancor::delta::reader mismatched_ds{ mismatched_bytes.data.data(), mismatched_bytes.data.data() + mismatched_bytes.data.size() };
+        bancor::multi::flat_row item;
+        mismatched_ds >> item;
+    } ) == "sx.bancor::multi: reserve weights symbol does not exist" );
+
+    std::vector<char> overlong( bytes.data.begin(), bytes.data.begin() + 24 );
+    overlong.insert( overlong.end(), { '\x80', '\x80', '\x80', '\x80', '\x80', '\x01' } );
+    REQUIRE( eosio::testing::check_failure( [&]() {
+        bancor::delta::reader overlong_ds{ overlong.data(), overlong.data() + overlong.size() };
+        bancor::multi::flat_row item;
+        overlong_ds >> item;
+    } ) == "sx.bancor::multi: invalid varuint32" );
+}
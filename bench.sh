@@ -0,0 +1,14 @@
+#!/bin/bash
+set -e
+
+# compile (native 128-bit backend & portable uint128_t class), fixtures resolved from any working directory
+FIXTURES="-DBANCOR_FIXTURES=\"$PWD/__tests__/fixtures/bancor.json\""
+g++ -std=c++17 -Wno-attributes -O2 -pthread -o bancor.bench.out bancor.bench.cpp -I __tests__ "$FIXTURES"
+g++ -std=c++17 -Wno-attributes -O2 -pthread -DSAFEMATH_UINT128_CLASS -o bancor.bench.class.out bancor.bench.cpp -I __tests__ "$FIXTURES"
+
+# benchmark (human readable output + JSON results per backend)
+./bancor.bench.out bancor.bench.json
+./bancor.bench.class.out bancor.bench.class.json
+
+# server tail latency per backend (p99 target measured on 8 cores, 8 workers & 16 clients)
+grep -H '"name": "server (' bancor.bench.json bancor.bench.class.json | sed -E 's/^([^:]*):.*"name": "([^"]*)".*"p99_ns": ([0-9.]+).*/\1: \2 p99 \3 ns/'
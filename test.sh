@@ -1,7 +1,11 @@
 #!/bin/bash
+set -e
 
-# compile
-g++ -std=c++11 -o bancor.t.out bancor.t.cpp -I __tests__
+# compile (native 128-bit backend & portable uint128_t class), fixtures resolved from any working directory
+FIXTURES="-DBANCOR_FIXTURES=\"$PWD/__tests__/fixtures/bancor.json\""
+g++ -std=c++17 -Wno-attributes -DCATCH_CONFIG_NO_POSIX_SIGNALS -pthread -o bancor.t.out bancor.t.cpp -I __tests__ "$FIXTURES"
+g++ -std=c++17 -Wno-attributes -DCATCH_CONFIG_NO_POSIX_SIGNALS -DSAFEMATH_UINT128_CLASS -pthread -o bancor.t.class.out bancor.t.cpp -I __tests__ "$FIXTURES"
 
 # test
 ./bancor.t.out --success
+./bancor.t.class.out --success